@@ -14,6 +14,17 @@ var __extends = (this && this.__extends) || (function () {
         d.prototype = b === null ? Object.create(b) : (__.prototype = b.prototype, new __());
     };
 })();
+var __assign = (this && this.__assign) || function () {
+    __assign = Object.assign || function(t) {
+        for (var s, i = 1, n = arguments.length; i < n; i++) {
+            s = arguments[i];
+            for (var p in s) if (Object.prototype.hasOwnProperty.call(s, p))
+                t[p] = s[p];
+        }
+        return t;
+    };
+    return __assign.apply(this, arguments);
+};
 var __awaiter = (this && this.__awaiter) || function (thisArg, _arguments, P, generator) {
     function adopt(value) { return value instanceof P ? value : new P(function (resolve) { resolve(value); }); }
     return new (P || (P = Promise))(function (resolve, reject) {
@@ -84,11 +95,13 @@ function Queue(value) {
     });
 }
 var quqeMap = new WeakMap();
+var pendingMap = new WeakMap();
+var lastId = 0;
 var OCR = /** @class */ (function (_super) {
     __extends(OCR, _super);
-    function OCR(path, args, options, debug) {
+    function OCR(path, args, options, debug, keepAlive, pipeline) {
         var _this = _super.call(this, (0, path_1.resolve)(__dirname, 'worker.js'), {
-            workerData: { path: path, args: args, options: options, debug: debug },
+            workerData: { path: path, args: args, options: options, debug: debug, keepAlive: keepAlive, pipeline: pipeline },
             stdout: true,
         }) || this;
         _this.exitCode = null;
@@ -107,6 +120,17 @@ var OCR = /** @class */ (function (_super) {
                 res();
             });
         });
+        if (pipeline) {
+            var pending_1 = new Map();
+            pendingMap.set(_this, pending_1);
+            _super.prototype.on.call(_this, 'message', function (data) {
+                var res = pending_1.get(data.id);
+                if (!res)
+                    return;
+                pending_1.delete(data.id);
+                res(data);
+            });
+        }
         _super.prototype.once.call(_this, 'exit', function (code) {
             _this.exitCode = code;
             quqeMap.get(_this).return(null);
@@ -116,14 +140,27 @@ var OCR = /** @class */ (function (_super) {
     OCR.prototype.postMessage = function (obj) { OCR.prototype.flush.call(this, obj); };
     OCR.prototype.flush = function (obj) {
         return __awaiter(this, void 0, void 0, function () {
+            var pending, id;
             var _this = this;
             return __generator(this, function (_a) {
                 switch (_a.label) {
-                    case 0: return [4 /*yield*/, quqeMap.get(this).next(function (res) {
+                    case 0:
+                        pending = pendingMap.get(this);
+                        if (!pending) return [3 /*break*/, 2];
+                        // Wait for init only, then keep several requests in flight
+                        return [4 /*yield*/, quqeMap.get(this).next(function (res) { return res(); })];
+                    case 1:
+                        _a.sent();
+                        id = ++lastId;
+                        return [2 /*return*/, new Promise(function (res) {
+                                pending.set(id, res);
+                                _super.prototype.postMessage.call(_this, __assign(__assign({}, obj), { id: id }));
+                            })];
+                    case 2: return [4 /*yield*/, quqeMap.get(this).next(function (res) {
                             _super.prototype.once.call(_this, 'message', res);
                             _super.prototype.postMessage.call(_this, obj);
                         })];
-                    case 1: return [2 /*return*/, (_a.sent()).value];
+                    case 3: return [2 /*return*/, (_a.sent()).value];
                 }
             });
         });
@@ -69,11 +69,13 @@ if (!worker_threads_1.isMainThread) {
     _c = _a.args,
     args = _c === void 0 ? [] : _c,
     options = _a.options,
-    debug_1 = _a.debug;
+    debug_1 = _a.debug,
+    keepAlive_1 = _a.keepAlive,
+    pipeline_1 = _a.pipeline;
   var mode_1 = 0;
   var proc_1 = (0, child_process_1.spawn)(
     path,
-    args.concat(__default.args),
+    args.concat(__default.args, pipeline_1 ? ["--pipeline=true"] : []),
     __assign(__assign({}, options), __default.options)
   );
   process.once("exit", proc_1.kill.bind(proc_1));
@@ -120,7 +122,37 @@ if (!worker_threads_1.isMainThread) {
         proc_1.stdout.destroy();
         proc_1.stderr.destroy();
       }
-      if (socket) {
+      if (socket && keepAlive_1) {
+        // One persistent connection for all requests, responses end with "\n"
+        var client_2 = new net_1.Socket();
+        var addr_2 = socket[0],
+          port_2 = socket[1];
+        var connected_1 = false;
+        client_2.on("close", function () {
+          return (connected_1 = false);
+        });
+        worker_threads_1.parentPort.on("message", function (data) {
+          var line = "".concat(
+            JSON.stringify(__assign(__assign({}, cargs(data)), { keep_alive: true })),
+            "\n"
+          );
+          if (connected_1) return client_2.write(line);
+          connected_1 = true;
+          client_2.connect(port_2, addr_2, function () {
+            return client_2.write(line);
+          });
+        });
+        var cache_2 = [];
+        client_2.on("data", function (chunk) {
+          var str = String(chunk);
+          cache_2.push(str);
+          if (end(str) !== "\n") return;
+          worker_threads_1.parentPort.postMessage(
+            cout(JSON.parse(cache_2.join("")))
+          );
+          cache_2.length = 0;
+        });
+      } else if (socket) {
         var client_1 = new net_1.Socket();
         var addr_1 = socket[0],
           port_1 = socket[1];
@@ -134,6 +166,24 @@ if (!worker_threads_1.isMainThread) {
             cout(JSON.parse(String(chunk)))
           );
         });
+      } else if (pipeline_1) {
+        // Several requests in flight, responses come back in completion order with their "id"
+        worker_threads_1.parentPort.on("message", function (data) {
+          proc_1.stdin.write("".concat(JSON.stringify(cargs(data)), "\n"));
+        });
+        var rest_1 = "";
+        proc_1.stdout.on("data", function (chunk) {
+          var lines = (rest_1 + String(chunk)).split("\n");
+          rest_1 = lines.pop();
+          for (var _i = 0, lines_1 = lines; _i < lines_1.length; _i++) {
+            var line = lines_1[_i];
+            if (!line) continue;
+            var data = JSON.parse(line);
+            worker_threads_1.parentPort.postMessage(
+              __assign(__assign({}, cout(data)), { id: data.id })
+            );
+          }
+        });
       } else {
         worker_threads_1.parentPort.on("message", function (data) {
           proc_1.stdin.write("".concat(JSON.stringify(cargs(data)), "\n"));
@@ -5,12 +5,13 @@ declare class OCR extends Worker {
     addr: string | undefined;
     port: number | undefined;
     exitCode: number | null;
-    constructor(path?: string, args?: string[], options?: OCR.Options, debug?: boolean);
+    constructor(path?: string, args?: string[], options?: OCR.Options, debug?: boolean, keepAlive?: boolean, pipeline?: boolean);
     postMessage(obj: OCR.Arg): void;
     flush(obj: OCR.Arg): Promise<OCR.coutReturnType>;
 }
 declare namespace OCR {
     interface BaseArg {
+        id?: number;
         limit_side_len?: number;
         limit_type?: string;
         visualize?: boolean;
@@ -31,6 +32,7 @@ declare namespace OCR {
             score: number;
             text: string;
         }[] | null;
+        id?: number;
     }
     export type Options = Omit<import('child_process').SpawnOptionsWithStdioTuple<'pipe', 'pipe', 'pipe'>, keyof typeof import('./worker').__default.options>;
     export {};
@@ -6,14 +6,16 @@ async function* Queue(value) {
         value = await new Promise(yield value);
 }
 const quqeMap = new WeakMap();
+const pendingMap = new WeakMap();
+let lastId = 0;
 class OCR extends worker_threads_1.Worker {
     pid;
     addr;
     port;
     exitCode = null;
-    constructor(path, args, options, debug) {
+    constructor(path, args, options, debug, keepAlive, pipeline) {
         super((0, path_1.resolve)(__dirname, 'worker.js'), {
-            workerData: { path, args, options, debug },
+            workerData: { path, args, options, debug, keepAlive, pipeline },
             stdout: true,
         });
         const quqe = Queue();
@@ -31,6 +33,17 @@ class OCR extends worker_threads_1.Worker {
                 res();
             });
         });
+        if (pipeline) {
+            const pending = new Map();
+            pendingMap.set(this, pending);
+            super.on('message', (data) => {
+                const res = pending.get(data.id);
+                if (!res)
+                    return;
+                pending.delete(data.id);
+                res(data);
+            });
+        }
         super.once('exit', (code) => {
             this.exitCode = code;
             quqeMap.get(this).return(null);
@@ -38,6 +51,16 @@ class OCR extends worker_threads_1.Worker {
     }
     postMessage(obj) { OCR.prototype.flush.call(this, obj); }
     async flush(obj) {
+        const pending = pendingMap.get(this);
+        if (pending) {
+            // Wait for init only, then keep several requests in flight
+            await quqeMap.get(this).next((res) => res());
+            const id = ++lastId;
+            return new Promise((res) => {
+                pending.set(id, res);
+                super.postMessage({ ...obj, id });
+            });
+        }
         return (await quqeMap.get(this).next((res) => {
             super.once('message', res);
             super.postMessage(obj);
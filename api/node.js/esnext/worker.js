@@ -46,9 +46,11 @@ if (!worker_threads_1.isMainThread) {
     args = [],
     options,
     debug,
+    keepAlive,
+    pipeline,
   } = worker_threads_1.workerData;
   let mode = 0;
-  const proc = (0, child_process_1.spawn)(path, args.concat(__default.args), {
+  const proc = (0, child_process_1.spawn)(path, args.concat(__default.args, pipeline ? ["--pipeline=true"] : []), {
     ...options,
     ...__default.options,
   });
@@ -92,7 +94,29 @@ if (!worker_threads_1.isMainThread) {
         proc.stdout.destroy();
         proc.stderr.destroy();
       }
-      if (socket) {
+      if (socket && keepAlive) {
+        // One persistent connection for all requests, responses end with "\n"
+        const client = new net_1.Socket();
+        const [addr, port] = socket;
+        let connected = false;
+        client.on("close", () => (connected = false));
+        worker_threads_1.parentPort.on("message", (data) => {
+          const line = `${JSON.stringify({ ...cargs(data), keep_alive: true })}\n`;
+          if (connected) return client.write(line);
+          connected = true;
+          client.connect(port, addr, () => client.write(line));
+        });
+        const cache = [];
+        client.on("data", (chunk) => {
+          const str = String(chunk);
+          cache.push(str);
+          if (end(str) !== "\n") return;
+          worker_threads_1.parentPort.postMessage(
+            cout(JSON.parse(cache.join("")))
+          );
+          cache.length = 0;
+        });
+      } else if (socket) {
         const client = new net_1.Socket();
         const [addr, port] = socket;
         worker_threads_1.parentPort.on("message", (data) => {
@@ -105,6 +129,21 @@ if (!worker_threads_1.isMainThread) {
             cout(JSON.parse(String(chunk)))
           );
         });
+      } else if (pipeline) {
+        // Several requests in flight, responses come back in completion order with their "id"
+        worker_threads_1.parentPort.on("message", (data) => {
+          proc.stdin.write(`${JSON.stringify(cargs(data))}\n`);
+        });
+        let rest = "";
+        proc.stdout.on("data", (chunk) => {
+          const lines = (rest + String(chunk)).split("\n");
+          rest = lines.pop();
+          for (const line of lines) {
+            if (!line) continue;
+            const data = JSON.parse(line);
+            worker_threads_1.parentPort.postMessage({ ...cout(data), id: data.id });
+          }
+        });
       } else {
         worker_threads_1.parentPort.on("message", (data) => {
           proc.stdin.write(`${JSON.stringify(cargs(data))}\n`);
@@ -6,15 +6,17 @@ async function* Queue<T>(value?: T): Queue<T> {
     while (true) value = await new Promise(yield value);
 }
 const quqeMap = new WeakMap<OCR, Queue<OCR.coutReturnType>>();
+const pendingMap = new WeakMap<OCR, Map<number, (value: OCR.coutReturnType) => void>>();
+let lastId = 0;
 
 class OCR extends Worker {
     pid: number;
     addr: string | undefined;
     port: number | undefined;
     exitCode: number | null = null;
-    constructor(path?: string, args?: string[], options?: OCR.Options, debug?: boolean) {
+    constructor(path?: string, args?: string[], options?: OCR.Options, debug?: boolean, keepAlive?: boolean, pipeline?: boolean) {
         super(path_resolve(__dirname, 'worker.js'), {
-            workerData: { path, args, options, debug },
+            workerData: { path, args, options, debug, keepAlive, pipeline },
             stdout: true,
         });
         const quqe = Queue<OCR.coutReturnType>();
@@ -32,6 +34,16 @@ class OCR extends Worker {
                 res();
             });
         });
+        if (pipeline) {
+            const pending = new Map<number, (value: OCR.coutReturnType) => void>();
+            pendingMap.set(this, pending);
+            super.on('message', (data: OCR.coutReturnType) => {
+                const res = pending.get(data.id);
+                if (!res) return;
+                pending.delete(data.id);
+                res(data);
+            });
+        }
         super.once('exit', (code) => {
             this.exitCode = code;
             quqeMap.get(this).return(null);
@@ -39,6 +51,16 @@ class OCR extends Worker {
     }
     postMessage(obj: OCR.Arg) { OCR.prototype.flush.call(this, obj); }
     async flush(obj: OCR.Arg) {
+        const pending = pendingMap.get(this);
+        if (pending) {
+            // Wait for init only, then keep several requests in flight
+            await quqeMap.get(this).next((res) => res());
+            const id = ++lastId;
+            return new Promise<OCR.coutReturnType>((res) => {
+                pending.set(id, res);
+                super.postMessage({ ...obj, id });
+            });
+        }
         return (await quqeMap.get(this).next((res) => {
             super.once('message', res);
             super.postMessage(obj);
@@ -49,6 +71,7 @@ class OCR extends Worker {
 namespace OCR {
 
     interface BaseArg {
+        id?: number;
         limit_side_len?: number;
         limit_type?: string;
         visualize?: boolean;
@@ -73,6 +96,7 @@ namespace OCR {
             score: number,
             text: string,
         }[] | null;
+        id?: number;
     }
 
     export type Options = Omit<
@@ -9,6 +9,8 @@ interface workerData {
   args?: string[];
   options?: Options;
   debug?: boolean;
+  keepAlive?: boolean;
+  pipeline?: boolean;
 }
 
 const __default = {
@@ -61,10 +63,12 @@ if (!isMainThread) {
     args = [],
     options,
     debug,
+    keepAlive,
+    pipeline,
   } = workerData as workerData;
   let mode = 0;
 
-  const proc = spawn(path, args.concat(__default.args), {
+  const proc = spawn(path, args.concat(__default.args, pipeline ? ["--pipeline=true"] : []), {
     ...options,
     ...__default.options,
   });
@@ -110,7 +114,27 @@ if (!isMainThread) {
         proc.stderr.destroy();
       }
 
-      if (socket) {
+      if (socket && keepAlive) {
+        // One persistent connection for all requests, responses end with "\n"
+        const client = new Socket();
+        const [addr, port] = socket;
+        let connected = false;
+        client.on("close", () => (connected = false));
+        parentPort.on("message", (data) => {
+          const line = `${JSON.stringify({ ...cargs(data), keep_alive: true })}\n`;
+          if (connected) return client.write(line);
+          connected = true;
+          client.connect(port, addr, () => client.write(line));
+        });
+        const cache = [];
+        client.on("data", (chunk) => {
+          const str = String(chunk);
+          cache.push(str);
+          if (end(str) !== "\n") return;
+          parentPort.postMessage(cout(JSON.parse(cache.join(""))));
+          cache.length = 0;
+        });
+      } else if (socket) {
         const client = new Socket();
         const [addr, port] = socket;
         parentPort.on("message", (data) => {
@@ -121,6 +145,21 @@ if (!isMainThread) {
         client.on("data", (chunk) => {
           parentPort.postMessage(cout(JSON.parse(String(chunk))));
         });
+      } else if (pipeline) {
+        // Several requests in flight, responses come back in completion order with their "id"
+        parentPort.on("message", (data) => {
+          proc.stdin.write(`${JSON.stringify(cargs(data))}\n`);
+        });
+        let rest = "";
+        proc.stdout.on("data", (chunk) => {
+          const lines = (rest + String(chunk)).split("\n");
+          rest = lines.pop();
+          for (const line of lines) {
+            if (!line) continue;
+            const data = JSON.parse(line);
+            parentPort.postMessage({ ...cout(data), id: data.id });
+          }
+        });
       } else {
         parentPort.on("message", (data) => {
           proc.stdin.write(`${JSON.stringify(cargs(data))}\n`);
@@ -7,20 +7,38 @@ import socket  # socket
 import atexit  # exit handling
 import subprocess  # process, pipe
 import re  # regex
+import threading  # pipelined pipe mode reader
+from concurrent.futures import Future  # pipelined pipe mode results
 from json import loads as jsonLoads, dumps as jsonDumps
 from sys import platform as sysPlatform  # popen silent mode
 from base64 import b64encode  # base64 encoding
 
 
 class PPOCR_pipe:  # Call OCR (pipe mode)
-    def __init__(self, exePath: str, modelsPath: str = None, argument: dict = None):
+    def __init__(
+        self,
+        exePath: str,
+        modelsPath: str = None,
+        argument: dict = None,
+        pipeline: bool = False,
+    ):
         """Initialize the recognizer (Pipe mode).\n
         `exePath`: Path to the recognizer `PaddleOCR_json.exe`.\n
         `modelsPath`: Path to the recognition library `models` folder. If None, assumes the library is in the same directory as the recognizer.\n
-        `argument`: Startup parameters, dictionary `{"key":value}`. Parameter description see https://github.com/hiroi-sora/PaddleOCR-json
+        `argument`: Startup parameters, dictionary `{"key":value}`. Parameter description see https://github.com/hiroi-sora/PaddleOCR-json\n
+        `pipeline`: Keep several requests in flight (engine `pipeline` mode). Requests are tagged with an `id` and may be sent from several threads, or with `submitDict()`.
         """
         # Private member variables
         self.__ENABLE_CLIPBOARD = False
+        # Pipelined mode: pending requests by id, answered by the reader thread
+        self.__pipeline = pipeline
+        self.__pending = {}
+        self.__lastId = 0
+        self.__pendingLock = threading.Lock()
+        self.__writeLock = threading.Lock()  # Separate, so responses are still taken while a large request is written
+        if pipeline:
+            argument = dict(argument) if argument else {}
+            argument["pipeline"] = True
 
         exePath = os.path.abspath(exePath)
         cwd = os.path.abspath(os.path.join(exePath, os.pardir))  # Get exe parent folder
@@ -68,8 +86,67 @@ class PPOCR_pipe:  # Call OCR (pipe mode)
                 break
             elif "OCR clipboard enbaled." in initStr:  # Detected clipboard enabled
                 self.__ENABLE_CLIPBOARD = True
+        if pipeline:
+            threading.Thread(target=self.__readLoop, args=(self.ret,), daemon=True).start()
         atexit.register(self.exit)  # Register to execute forced stop subprocess when program terminates
 
+    def __readLoop(self, ret):
+        """Pipelined mode: read responses as they finish and hand each one to the request with its id."""
+        while True:
+            try:
+                getStr = ret.stdout.readline()
+            except Exception:
+                getStr = b""
+            if not getStr:
+                break
+            getStr = getStr.decode("utf-8", errors="ignore")
+            try:
+                res = jsonLoads(getStr)
+            except Exception as e:
+                print(f"[Error] Recognizer output value JSON deserialization failed. {e}. Original content: [{getStr}]")
+                continue
+            with self.__pendingLock:
+                future = self.__pending.pop(res.pop("id", None), None)
+            if future:
+                future.set_result(res)
+        # Process ended, fail the requests still waiting
+        with self.__pendingLock:
+            pending, self.__pending = self.__pending, {}
+        for future in pending.values():
+            future.set_result({"code": 903, "data": "Recognizer process closed before answering."})
+
+    def submitDict(self, writeDict: dict) -> Future:
+        """Pipelined mode: send an instruction dictionary without waiting for its result.\n
+        `writeDict`: Instruction dictionary.\n
+        `return`:  Future of {"code": identification code, "data": content list or error message string}\n"""
+        future = Future()
+        if not self.__pipeline:
+            future.set_result(self.runDict(writeDict))
+            return future
+        if not self.ret:
+            future.set_result({"code": 901, "data": f"Engine instance does not exist."})
+            return future
+        if not self.ret.poll() == None:
+            future.set_result({"code": 902, "data": f"Subprocess has crashed."})
+            return future
+        with self.__pendingLock:
+            self.__lastId += 1
+            writeId = self.__lastId
+            self.__pending[writeId] = future
+        writeStr = jsonDumps({**writeDict, "id": writeId}, ensure_ascii=True, indent=None) + "\n"
+        with self.__writeLock:
+            try:
+                self.ret.stdin.write(writeStr.encode("utf-8"))
+                self.ret.stdin.flush()
+            except Exception as e:
+                with self.__pendingLock:
+                    self.__pending.pop(writeId, None)
+                future.set_result({
+                    "code": 902,
+                    "data": f"Failed to pass instruction to recognizer process, suspected subprocess has crashed. {e}",
+                })
+        return future
+
     def isClipboardEnabled(self) -> bool:
         return self.__ENABLE_CLIPBOARD
 
@@ -81,6 +158,8 @@ class PPOCR_pipe:  # Call OCR (pipe mode)
         """Pass instruction dictionary, send to engine process.\n
         `writeDict`: Instruction dictionary.\n
         `return`:  {"code": identification code, "data": content list or error message string}\n"""
+        if self.__pipeline:
+            return self.submitDict(writeDict).result()
         # Check subprocess
         if not self.ret:
             return {"code": 901, "data": f"Engine instance does not exist."}
@@ -177,12 +256,24 @@ class PPOCR_pipe:  # Call OCR (pipe mode)
 class PPOCR_socket(PPOCR_pipe):
     """Call OCR (socket mode)"""
 
-    def __init__(self, exePath: str, modelsPath: str = None, argument: dict = None):
+    def __init__(
+        self,
+        exePath: str,
+        modelsPath: str = None,
+        argument: dict = None,
+        keepAlive: bool = False,
+    ):
         """Initialize recognizer (socket mode).\n
         `exePath`: Path to the recognizer `PaddleOCR_json.exe`.\n
         `modelsPath`: Path to the recognition library `models` folder. If None, assumes the library is in the same directory as the recognizer.\n
-        `argument`: Startup parameters, dictionary `{"key":value}`. Parameter description see https://github.com/hiroi-sora/PaddleOCR-json
+        `argument`: Startup parameters, dictionary `{"key":value}`. Parameter description see https://github.com/hiroi-sora/PaddleOCR-json\n
+        `keepAlive`: Reuse one TCP connection for all requests instead of connecting for each one.
         """
+        # Persistent connection (keep-alive mode)
+        self.__keepAlive = keepAlive
+        self.__socket = None
+        self.__recvBuffer = b""
+
         # Process parameters
         if not argument:
             argument = {}
@@ -241,6 +332,9 @@ class PPOCR_socket(PPOCR_pipe):
             if not self.ret.poll() == None:
                 return {"code": 901, "data": f"Subprocess has crashed."}
 
+        if self.__keepAlive:
+            return self.__runKeepAlive(writeDict)
+
         # Communication
         writeStr = jsonDumps(writeDict, ensure_ascii=True, indent=None) + "\n"
         try:
@@ -276,8 +370,57 @@ class PPOCR_socket(PPOCR_pipe):
                 "data": f"Recognizer output value JSON deserialization failed. Exception info: [{e}]. Original content: [{getStr}]",
             }
 
+    def __runKeepAlive(self, writeDict: dict):
+        """Send instruction dictionary over the persistent connection.\n
+        Responses end with a line break. If the server has closed the idle connection, reconnect once and resend."""
+        writeDict = dict(writeDict, keep_alive=True)
+        writeStr = jsonDumps(writeDict, ensure_ascii=True, indent=None) + "\n"
+        for attempt in range(2):
+            try:
+                if self.__socket is None:
+                    self.__socket = socket.create_connection((self.ip, self.port))
+                    self.__recvBuffer = b""
+                self.__socket.sendall(writeStr.encode())
+                while b"\n" not in self.__recvBuffer:
+                    chunk = self.__socket.recv(65536)
+                    if not chunk:
+                        raise ConnectionResetError("Connection closed by server")
+                    self.__recvBuffer += chunk
+                getBytes, self.__recvBuffer = self.__recvBuffer.split(b"\n", 1)
+                getStr = getBytes.decode()
+                break
+            except ConnectionRefusedError:
+                self.__closeSocket()
+                return {"code": 902, "data": "Connection refused"}
+            except TimeoutError:
+                self.__closeSocket()
+                return {"code": 903, "data": "Connection timeout"}
+            except Exception as e:
+                self.__closeSocket()
+                if attempt:
+                    return {"code": 904, "data": f"Network error: {e}"}
+        # Deserialize output information
+        try:
+            return jsonLoads(getStr)
+        except Exception as e:
+            return {
+                "code": 905,
+                "data": f"Recognizer output value JSON deserialization failed. Exception info: [{e}]. Original content: [{getStr}]",
+            }
+
+    def __closeSocket(self):
+        """Close the persistent connection, if any"""
+        if self.__socket is not None:
+            try:
+                self.__socket.close()
+            except Exception:
+                pass
+        self.__socket = None
+        self.__recvBuffer = b""
+
     def exit(self):
         """Close engine subprocess"""
+        self.__closeSocket()
         # Only close engine process in local mode
         if hasattr(self, "ret"):
             if self.__runningMode == "local":
@@ -20,6 +20,24 @@
 DECLARE_string(image_path);
 DECLARE_int32(port);
 DECLARE_string(addr);
+DECLARE_int32(http_port);
+DECLARE_string(unix_socket);
+DECLARE_int32(workers);
+DECLARE_int32(queue_size);
+DECLARE_int32(bulk_share);
+DECLARE_int32(cache_mb);
+DECLARE_int32(reduced_decode_mp);
+DECLARE_int32(keep_alive_timeout);
+DECLARE_bool(framed);
+DECLARE_int32(max_frame_mb);
+DECLARE_bool(pipeline);
+DECLARE_string(image_dir);
+DECLARE_string(manifest);
+DECLARE_string(batch_output);
+DECLARE_int32(prefetch);
+DECLARE_int32(decode_threads);
+DECLARE_string(output_order);
+DECLARE_bool(stage_pipeline);
 
 // common args
 DECLARE_bool(use_gpu);
@@ -0,0 +1,34 @@
+// PaddleOCR-json
+// https://github.com/hiroi-sora/PaddleOCR-json
+
+#ifndef BASE64_FAST_H
+#define BASE64_FAST_H
+
+#include <cstddef>
+
+// Base64 decoding into a caller provided buffer, for image payloads of requests.
+// Accepts the standard and the url-safe alphabet, padding ('=' or '.') is optional, like base64_decode().
+// The standard alphabet is decoded with SSE4.1 or AVX2 when the CPU supports it, chosen at runtime.
+
+// Instruction sets the decoder can use
+enum Base64Simd
+{
+    BASE64_SCALAR = 0,
+    BASE64_SSE41 = 1,
+    BASE64_AVX2 = 2,
+};
+
+// Best instruction set supported by this CPU
+Base64Simd base64_simd_support();
+
+// Number of bytes src decodes to, padding excluded. Also valid for strings that turn out not to be base64.
+size_t base64_decoded_length(const char *src, size_t length);
+
+// Decode length base64 chars of src into dst, which must hold base64_decoded_length(src, length) bytes.
+// Return false if src is not valid base64.
+bool base64_decode_into(const char *src, size_t length, unsigned char *dst);
+
+// Same as above, but use at most the given instruction set. For tests and benchmarks.
+bool base64_decode_into(const char *src, size_t length, unsigned char *dst, Base64Simd simd);
+
+#endif // BASE64_FAST_H
@@ -0,0 +1,48 @@
+// PaddleOCR-json
+// https://github.com/hiroi-sora/PaddleOCR-json
+
+#ifndef BATCH_IO_H
+#define BATCH_IO_H
+
+#include <istream>
+#include <map>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace PaddleOCR
+{
+    // ==================== Batch mode input and output ====================
+
+    // Whether a file name has the extension of an image format OpenCV decodes, case insensitive
+    bool is_image_file(const std::string &name);
+    // Image paths of a manifest, one per line. Line breaks may be \n or \r\n, empty lines are skipped.
+    std::vector<std::string> read_manifest(std::istream &in);
+    // Json string of an image path for the "path" member of its line. Bytes that are not valid UTF-8 are replaced by U+FFFD.
+    std::string batch_path_json(const std::string &path, bool ensure_ascii);
+    // Result line of an image that has no OCR result: {"code":code,"data":msg,"path":path}.
+    // Like batch_path_json, it cannot fail, so every image gets its line.
+    std::string batch_error_line(int code, const std::string &msg, const std::string &path, bool ensure_ascii);
+
+    // Writes one line per image, in input order or as they complete. In input order a line waits until
+    // the lines of all earlier images are written, so every image must get exactly one line.
+    // Not thread safe, callers serialize their calls.
+    class BatchWriter
+    {
+    public:
+        BatchWriter(std::ostream &out, bool input_order);
+
+        void write(size_t index, std::string line); // Line of the image at index
+        size_t held() const;                        // Number of lines waiting for an earlier one
+        void finish();                              // Write the waiting lines in order, leaving out the missing ones
+
+    private:
+        std::ostream &out_;
+        bool input_order_;
+        size_t next_ = 0;                        // Index of the next line in input order
+        std::map<size_t, std::string> ahead_;    // Lines ready before next_, input order only
+    };
+
+} // namespace PaddleOCR
+
+#endif // BATCH_IO_H
@@ -0,0 +1,66 @@
+// PaddleOCR-json
+// https://github.com/hiroi-sora/PaddleOCR-json
+
+#ifndef HTTP_H
+#define HTTP_H
+
+#include <string>
+
+namespace PaddleOCR
+{
+    // One HTTP request read by HttpParser
+    struct HttpRequest
+    {
+        std::string method;       // e.g. "POST"
+        std::string path;         // Request target without query string
+        std::string content_type; // Media type in lower case, without parameters
+        std::string body;         // Request body, already de-chunked
+        bool keep_alive = true;   // Client keeps the connection open after the response
+        bool http_1_1 = true;     // HTTP/1.1 client, which accepts chunked responses
+    };
+
+    // ==================== Incremental HTTP/1.1 request parser ====================
+    // Fed with the receive buffer of a connection whenever more bytes arrive. Supports
+    // Content-Length and chunked bodies, keep-alive and "Expect: 100-continue".
+    class HttpParser
+    {
+    public:
+        enum State
+        {
+            HTTP_INCOMPLETE, // More bytes are needed
+            HTTP_COMPLETE,   // request is filled, its bytes are removed from the buffer
+            HTTP_FAILED      // Malformed or too large request, see error_status()
+        };
+
+        explicit HttpParser(size_t max_body); // Largest accepted body in bytes
+
+        State parse(std::string &buffer, HttpRequest &request); // Try to take one request off the front of buffer
+        bool expects_continue();                                  // True once when the client waits for "100 Continue" before sending its body
+        int error_status() const;                                 // HTTP status code describing why parsing failed
+
+    private:
+        size_t max_body_;
+        size_t scanned_ = 0;      // Bytes of the buffer already searched for the end of the header
+        size_t header_end_ = 0;   // Length of the header including its blank line, 0 while incomplete
+        size_t pos_ = 0;          // Parse position inside a chunked body
+        size_t content_length_ = 0;
+        bool chunked_ = false;
+        bool chunks_done_ = false;   // Last chunk seen, waiting for the trailer end
+        bool expect_continue_ = false;
+        int error_ = 0;
+        HttpRequest request_;        // Request being parsed
+
+        State fail(int status);
+        State parse_header(const std::string &buffer);
+        State parse_chunks(const std::string &buffer);
+        void reset();
+    };
+
+    const char *http_reason(int status); // Reason phrase of a status code
+    // Status line and headers of a response. Without chunked the body length is given in content_length.
+    std::string http_head(int status, const std::string &content_type, bool keep_alive, bool chunked, size_t content_length = 0);
+    void http_chunk(std::string &out, const char *data, size_t length); // Append one chunk of a chunked body, length 0 ends the body
+
+} // namespace PaddleOCR
+
+#endif // HTTP_H
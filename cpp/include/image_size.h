@@ -0,0 +1,32 @@
+// PaddleOCR-json
+// https://github.com/hiroi-sora/PaddleOCR-json
+
+#ifndef IMAGE_SIZE_H
+#define IMAGE_SIZE_H
+
+#include <cstddef>
+#include <string>
+
+namespace PaddleOCR
+{
+    // ==================== Reduced decode ====================
+    // JPEG decoders can scale by 1/2, 1/4 and 1/8 while decoding, at a fraction of the cost of a full decode.
+    // Detection resizes its input to limit_side_len anyway, so huge photos are decoded reduced for it.
+
+    // Read the size of a JPEG image from its headers without decoding it. False if data is no JPEG or is cut before the frame header.
+    bool jpeg_size(const unsigned char *data, size_t length, int &width, int &height);
+    // Largest reduction (1, 2, 4 or 8) of a width x height image that keeps its long side at limit_side_len or more.
+    // 1 for images below min_megapixels, when min_megapixels is 0 or less, or when limit_type is not "max":
+    // with "min", detection does not shrink large images, so it needs them at full resolution.
+    int reduced_decode_scale(int width, int height, const std::string &limit_type, int limit_side_len, int min_megapixels);
+
+    // ==================== Raw pixels ====================
+
+    // Bytes a raw image of height rows needs, each row_bytes long and stride bytes after the previous one.
+    // Padding after the last row is not required. SIZE_MAX when the size does not fit in size_t, so a
+    // huge stride from a request can not wrap around and pass a length check.
+    size_t raw_image_bytes(size_t row_bytes, int height, size_t stride);
+
+} // namespace PaddleOCR
+
+#endif // IMAGE_SIZE_H
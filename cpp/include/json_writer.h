@@ -0,0 +1,47 @@
+// PaddleOCR-json
+// https://github.com/hiroi-sora/PaddleOCR-json
+
+#ifndef JSON_WRITER_H
+#define JSON_WRITER_H
+
+#include <string>
+
+namespace PaddleOCR
+{
+    // ==================== Direct json writer ====================
+    // Append json values to a string buffer without building a json DOM.
+    // The output is byte for byte what nlohmann::json::dump(-1, ' ', ensure_ascii) writes for the same value.
+
+    // Append a quoted json string. Throw std::invalid_argument if str is not valid UTF-8.
+    void json_append_string(std::string &out, const std::string &str, bool ensure_ascii);
+    // Append an integer
+    void json_append_int(std::string &out, long long value);
+    // Append a floating point number, null when it is not finite
+    void json_append_float(std::string &out, double value);
+
+    // ==================== Direct MessagePack and CBOR writer ====================
+    // Append binary encoded values to a string buffer without building a DOM, in CBOR when cbor is set, else MessagePack.
+    // Values are encoded byte for byte like nlohmann::json::to_msgpack / to_cbor encode them.
+
+    // Append the header of a map with size members. Each member follows as its key string, then its value.
+    void bin_append_map(std::string &out, bool cbor, size_t size);
+    // Append the header of an array with size values
+    void bin_append_array(std::string &out, bool cbor, size_t size);
+    // Append a string. Throw std::invalid_argument if str is not valid UTF-8.
+    void bin_append_string(std::string &out, bool cbor, const std::string &str);
+    // Append an integer
+    void bin_append_int(std::string &out, bool cbor, long long value);
+    // Append a floating point number, nil when it is not finite (like the json writer writes null)
+    void bin_append_float(std::string &out, bool cbor, double value);
+
+    // Responses are maps whose header always holds a 16 bit member count, so members can be appended to a written
+    // response. Append such a header with size members.
+    void bin_begin_response(std::string &out, bool cbor, size_t size);
+    // Whether a buffer starts with a response header. Json responses start with '{' instead.
+    bool bin_is_response(const std::string &out);
+    // Count one more member in the response header at the start of out. The caller appends its key and value.
+    void bin_grow_response(std::string &out);
+
+} // namespace PaddleOCR
+
+#endif // JSON_WRITER_H
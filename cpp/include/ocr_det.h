@@ -23,6 +23,17 @@
 namespace PaddleOCR
 {
 
+    // Resize and post-processing parameters of a detection. The constructor sets the defaults, a request may override them.
+    struct DBDetectorParams
+    {
+        std::string limit_type = "max";
+        int limit_side_len = 960;
+        double det_db_thresh = 0.3;
+        double det_db_box_thresh = 0.5;
+        double det_db_unclip_ratio = 2.0;
+        std::string det_db_score_mode = "slow";
+    };
+
     class DBDetector
     {
     public:
@@ -43,13 +54,13 @@ namespace PaddleOCR
             this->cpu_math_library_num_threads_ = cpu_math_library_num_threads;
             this->use_mkldnn_ = use_mkldnn;
 
-            this->limit_type_ = limit_type;
-            this->limit_side_len_ = limit_side_len;
+            this->params_.limit_type = limit_type;
+            this->params_.limit_side_len = limit_side_len;
 
-            this->det_db_thresh_ = det_db_thresh;
-            this->det_db_box_thresh_ = det_db_box_thresh;
-            this->det_db_unclip_ratio_ = det_db_unclip_ratio;
-            this->det_db_score_mode_ = det_db_score_mode;
+            this->params_.det_db_thresh = det_db_thresh;
+            this->params_.det_db_box_thresh = det_db_box_thresh;
+            this->params_.det_db_unclip_ratio = det_db_unclip_ratio;
+            this->params_.det_db_score_mode = det_db_score_mode;
             this->use_dilation_ = use_dilation;
 
             this->use_tensorrt_ = use_tensorrt;
@@ -61,9 +72,9 @@ namespace PaddleOCR
         // Load Paddle inference model
         void LoadModel(const std::string &model_dir);
 
-        // Run predictor
+        // Run predictor. params replaces the parameters given to the constructor for this run.
         void Run(cv::Mat &img, std::vector<std::vector<std::vector<int>>> &boxes,
-                 std::vector<double> &times);
+                 std::vector<double> &times, const DBDetectorParams *params = nullptr);
         std::shared_ptr<paddle_infer::Predictor> predictor_; // Inference library instance
 
     private:
@@ -73,13 +84,7 @@ namespace PaddleOCR
         int cpu_math_library_num_threads_ = 4;
         bool use_mkldnn_ = false;
 
-        std::string limit_type_ = "max";
-        int limit_side_len_ = 960;
-
-        double det_db_thresh_ = 0.3;
-        double det_db_box_thresh_ = 0.5;
-        double det_db_unclip_ratio_ = 2.0;
-        std::string det_db_score_mode_ = "slow";
+        DBDetectorParams params_; // Default resize and post-processing parameters
         bool use_dilation_ = false;
 
         bool visualize_ = true;
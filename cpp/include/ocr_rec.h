@@ -17,6 +17,8 @@
 #include "paddle_api.h"
 #include "paddle_inference_api.h"
 
+#include <functional>
+
 #include <include/ocr_cls.h>
 #include <include/utility.h>
 
@@ -59,8 +61,13 @@ namespace PaddleOCR
         // Load Paddle inference model
         void LoadModel(const std::string &model_dir);
 
-        void Run(std::vector<cv::Mat> img_list, std::vector<std::string> &rec_texts,
-                 std::vector<float> &rec_text_scores, std::vector<double> &times);
+        // Recognize img_list in batches. next_batch is called before each batch; once it returns false no further
+        // batch is started, lines of the skipped batches keep an empty text and score 0. Return false when batches were skipped.
+        // batch_done is called after each batch with the indices of its lines, whose results are filled in by then.
+        bool Run(std::vector<cv::Mat> img_list, std::vector<std::string> &rec_texts,
+                 std::vector<float> &rec_text_scores, std::vector<double> &times,
+                 const std::function<bool()> &next_batch = nullptr,
+                 const std::function<void(const std::vector<int> &)> &batch_done = nullptr);
         std::shared_ptr<paddle_infer::Predictor> predictor_; // Inference library instance
 
     private:
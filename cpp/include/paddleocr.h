@@ -14,6 +14,8 @@
 
 #pragma once
 
+#include <functional>
+
 #include <include/ocr_cls.h>
 #include <include/ocr_det.h>
 #include <include/ocr_rec.h>
@@ -22,8 +24,12 @@ namespace PaddleOCR
 {
     class PPOCR
     {
+        friend class StagePipeline; // Runs the stages of single image ocr() calls on engines of their own
+
     public:
         explicit PPOCR();
+        explicit PPOCR(const PPOCR &base); // Clone base engine. Predictors share model weights with base, but can run in parallel to it
+        PPOCR(const PPOCR &base, bool det, bool cls, bool rec); // Clone only the given models of base engine
         ~PPOCR() = default; // Default destructor
 
         // OCR method, process image list, return OCR result vector for each image
@@ -35,6 +41,26 @@ namespace PaddleOCR
         std::vector<OCRPredictResult> ocr(cv::Mat img, bool det = true,
                                           bool rec = true, bool cls = true);
 
+        // Stop ocr() calls early once deadline has passed: no further stage or rec batch is started, and
+        // the lines recognized so far are returned. The default deadline never passes.
+        void set_deadline(std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::time_point::max());
+        bool is_timeout() const; // Last ocr() call ran out of time, its results are partial
+        // Called between the stages of ocr() calls (before det, cls and each rec batch), e.g. to let a more urgent
+        // request use this engine in between. State of the interrupted call is restored afterwards. nullptr removes it.
+        void set_stage_hook(std::function<void()> hook);
+        // Called during single image ocr() calls with the lines found so far, by index into its result: after det
+        // with all lines (boxes only), then after each rec batch with the lines it recognized. nullptr removes it.
+        void set_line_hook(std::function<void(const std::vector<OCRPredictResult> &, const std::vector<int> &)> hook);
+        // Detection parameters of the following ocr() calls, nullptr for the startup flags. params must outlive the calls.
+        void set_det_params(const DBDetectorParams *params = nullptr);
+        // Regions of interest of the following ocr() calls, nullptr for the whole image. Detection runs on each region at
+        // its own resolution; without det, a single image call recognizes each region as one line. rois must outlive the calls.
+        void set_rois(const std::vector<cv::Rect> *rois = nullptr);
+        // Full resolution source of the following single image ocr() calls, when their image is a reduced decode of it.
+        // Detection runs on the reduced image; its boxes are scaled up and the lines are cropped from what loader
+        // returns, so results are in full resolution coordinates. nullptr, or an empty Mat from loader, crops the image itself.
+        void set_full_image(std::function<cv::Mat()> loader = nullptr);
+
         void reset_timer();              // Reset timer
         void benchmark_log(int img_num); // Log benchmark, parameter is image count
 
@@ -49,6 +75,20 @@ namespace PaddleOCR
         std::vector<double> time_info_rec = {0, 0, 0};
         std::vector<double> time_info_cls = {0, 0, 0};
 
+        std::chrono::steady_clock::time_point deadline_ = std::chrono::steady_clock::time_point::max();
+        bool timeout_ = false; // Current ocr() call ran out of time
+        bool out_of_time();    // Check the deadline, remember when it has passed
+        const DBDetectorParams *det_params_ = nullptr;
+        const std::vector<cv::Rect> *rois_ = nullptr;
+        std::function<cv::Mat()> full_loader_;
+        std::function<void()> stage_hook_;
+        std::function<void(const std::vector<OCRPredictResult> &, const std::vector<int> &)> line_hook_;
+        bool next_stage();     // Before starting a stage: run the stage hook, then return false if out of time
+
+        // Text lines of a single image: detect and crop them, or without det take the regions of interest or the whole image
+        void find_lines(cv::Mat img, bool det,
+                        std::vector<OCRPredictResult> &ocr_results,
+                        std::vector<cv::Mat> &img_list);
         // Text detection: input single image, store single line text fragment detection info in ocr_results vector
         void det(cv::Mat img,
                  std::vector<OCRPredictResult> &ocr_results);
@@ -58,5 +98,9 @@ namespace PaddleOCR
         // Text recognition: input single line fragment vector, store text for each fragment in ocr_results vector
         void rec(std::vector<cv::Mat> img_list,
                  std::vector<OCRPredictResult> &ocr_results);
+        // Direction classification (rotating fragments as needed) and text recognition of line fragments
+        void cls_rec(std::vector<cv::Mat> &img_list,
+                     std::vector<OCRPredictResult> &ocr_results,
+                     bool rec, bool cls);
     };
 } // namespace PaddleOCR
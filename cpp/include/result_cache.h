@@ -0,0 +1,59 @@
+// PaddleOCR-json
+// https://github.com/hiroi-sora/PaddleOCR-json
+
+#ifndef RESULT_CACHE_H
+#define RESULT_CACHE_H
+
+#include <chrono>
+#include <condition_variable>
+#include <list>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+
+namespace PaddleOCR
+{
+    // ==================== OCR result cache ====================
+    // LRU cache of response strings, keyed by a hash of the decoded image and the OCR parameters.
+    // Identical requests arriving while the first one is still computing wait for its result
+    // instead of computing it again.
+    class ResultCache
+    {
+    public:
+        explicit ResultCache(size_t max_bytes); // Largest total size of keys and results, 0 disables the cache
+
+        // Look up key. On a hit copy the result and return true. On a miss return false; if owner is set,
+        // the caller computes the result and must hand it to finish(). If another thread is computing the
+        // same key, wait for it first, unless this thread is computing a key itself. Waiting ends at the caller's
+        // deadline with a miss, so the caller computes the result without caching it, or times out on its own.
+        bool acquire(const std::string &key, std::string &result, bool &owner,
+                     std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::time_point::max());
+        // Store the result computed by the owner of key, or nullptr if it must not be cached, and wake the waiters
+        void finish(const std::string &key, const std::string *result);
+
+        bool enabled() const; // Whether the cache holds anything at all
+        size_t bytes() const; // Current total size
+
+    private:
+        struct Entry
+        {
+            std::string result;
+            std::list<std::string>::iterator lru; // Position in lru_
+        };
+
+        size_t max_bytes_;
+        size_t bytes_ = 0;
+        std::unordered_map<std::string, Entry> entries_;
+        std::list<std::string> lru_;                                  // Keys, most recently used first
+        std::unordered_map<std::string, std::thread::id> computing_; // Keys being computed, by the computing thread
+        mutable std::mutex mutex_;
+        std::condition_variable cond_;
+
+        static size_t entry_size(const std::string &key, const std::string &result);
+        void evict(); // Drop least recently used entries until the size limit is met
+    };
+
+} // namespace PaddleOCR
+
+#endif // RESULT_CACHE_H
@@ -0,0 +1,59 @@
+// PaddleOCR-json
+// https://github.com/hiroi-sora/PaddleOCR-json
+
+#ifndef STAGE_PIPELINE_H
+#define STAGE_PIPELINE_H
+
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <opencv2/core.hpp>
+
+#include "include/stage_runner.h"
+#include "include/utility.h"
+
+namespace PaddleOCR
+{
+    class Task;
+
+    // ==================== OCR stage pipeline ====================
+    // Runs single image OCR as three stages, det (with cropping), cls and rec, each on threads of its own.
+    // Every stage thread owns one Task whose engine holds only the model of its stage (predictors share the
+    // weights of the base task). Stages are connected by bounded queues, so while the lines of one image
+    // are recognized the next images are already detected. Results equal those of PPOCR::ocr(img, det, rec, cls).
+    class StagePipeline
+    {
+    public:
+        // Takes the result of an image, or the error that stopped it ("" on success). Runs on a stage thread.
+        typedef std::function<void(Task &, std::vector<OCRPredictResult> &, const std::string &)> Done;
+
+        // Start threads_per_stage threads per stage. Every queue holds up to queue_size images.
+        StagePipeline(const Task &base, int threads_per_stage, int queue_size, bool det, bool rec, bool cls);
+        ~StagePipeline(); // Finish queued images, then stop and join all stage threads
+
+        // Queue an image for det, wait while that queue is full. When img is a reduced decode, full_loader
+        // decodes it in full resolution for cropping the lines, see PPOCR::set_full_image.
+        void submit(cv::Mat img, std::function<cv::Mat()> full_loader, Done done);
+
+    private:
+        struct Item // One image on its way through the stages
+        {
+            cv::Mat img;                           // Released once its lines are cropped
+            std::function<cv::Mat()> full_loader;  // Full resolution decode of a reduced img, or nullptr
+            std::vector<OCRPredictResult> lines;   // Lines found so far
+            std::vector<cv::Mat> crops;            // Line images, in the order of lines
+            Done done;
+        };
+
+        bool det_, rec_, cls_;
+        std::vector<std::unique_ptr<Task>> tasks_;        // Stage tasks, owned by the pipeline
+        std::unique_ptr<StageRunner<Task, Item>> runner_; // Declared after tasks_, so it stops first
+
+        Task &stage_task(const Task &base, bool det, bool cls, bool rec); // New task with a clone of the given models
+    };
+
+} // namespace PaddleOCR
+
+#endif // STAGE_PIPELINE_H
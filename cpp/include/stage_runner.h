@@ -0,0 +1,174 @@
+// PaddleOCR-json
+// https://github.com/hiroi-sora/PaddleOCR-json
+
+#ifndef STAGE_RUNNER_H
+#define STAGE_RUNNER_H
+
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace PaddleOCR
+{
+    // ==================== Stages of threads connected by queues ====================
+
+    // Bounded FIFO between two stages
+    template <class T>
+    class StageQueue
+    {
+    public:
+        explicit StageQueue(size_t capacity) : capacity_(capacity < 1 ? 1 : capacity) {}
+
+        void push(T item) // Wait for room, then append
+        {
+            {
+                std::unique_lock<std::mutex> lock(mutex_);
+                not_full_.wait(lock, [this]
+                               { return items_.size() < capacity_; });
+                items_.push_back(std::move(item));
+            }
+            not_empty_.notify_one();
+        }
+
+        bool pop(T &item) // Wait for an item, false once closed and drained
+        {
+            {
+                std::unique_lock<std::mutex> lock(mutex_);
+                not_empty_.wait(lock, [this]
+                                { return closed_ || !items_.empty(); });
+                if (items_.empty()) // Closed and nothing left
+                    return false;
+                item = std::move(items_.front());
+                items_.pop_front();
+            }
+            not_full_.notify_one();
+            return true;
+        }
+
+        void close() // No more items will be pushed
+        {
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                closed_ = true;
+            }
+            not_empty_.notify_all();
+        }
+
+    private:
+        std::deque<T> items_;
+        size_t capacity_;
+        bool closed_ = false;
+        std::mutex mutex_;
+        std::condition_variable not_empty_, not_full_;
+    };
+
+    // Passes items through a fixed list of stages. Every stage runs one thread per worker, and every stage
+    // reads from a queue of its own. An item that passes the last stage, or throws in any stage, ends with
+    // exactly one call of finish on the worker that had it last; a failed item skips the remaining stages.
+    template <class Worker, class Item>
+    class StageRunner
+    {
+    public:
+        typedef std::function<void(Worker &, Item &)> Work;                       // Runs a stage on an item, throws to fail it
+        typedef std::function<void(Worker &, Item &, const std::string &)> Finish; // Last call on an item, with the error that stopped it or ""
+
+        struct Stage
+        {
+            const char *name;              // For error messages
+            std::vector<Worker *> workers; // One thread each, not owned
+            Work work;
+        };
+
+        // Start the threads of all stages. Every queue holds up to queue_size items.
+        StageRunner(std::vector<Stage> stages, size_t queue_size, Finish finish)
+            : stages_(std::move(stages)), finish_(std::move(finish))
+        {
+            for (size_t s = 0; s < stages_.size(); s++)
+                queues_.emplace_back(new StageQueue<std::unique_ptr<Item>>(queue_size));
+            for (size_t s = 0; s < stages_.size(); s++)
+            {
+                threads_.emplace_back();
+                for (Worker *worker : stages_[s].workers)
+                    threads_[s].emplace_back(&StageRunner::loop, this, s, std::ref(*worker));
+            }
+        }
+        ~StageRunner() { stop(); }
+
+        void submit(std::unique_ptr<Item> item) // Queue an item for the first stage, wait while that queue is full
+        {
+            queues_.front()->push(std::move(item));
+        }
+
+        void stop() // Finish queued items, then join all threads
+        {
+            // Drain the stages front to back, so every queued item reaches the end
+            for (size_t s = 0; s < stages_.size(); s++)
+            {
+                queues_[s]->close();
+                for (auto &t : threads_[s])
+                {
+                    if (t.joinable())
+                        t.join();
+                }
+            }
+        }
+
+    private:
+        std::vector<Stage> stages_;
+        Finish finish_;
+        std::vector<std::unique_ptr<StageQueue<std::unique_ptr<Item>>>> queues_;
+        std::vector<std::vector<std::thread>> threads_; // Per stage
+
+        void loop(size_t s, Worker &worker) // Stage thread body
+        {
+            bool last = s + 1 == stages_.size();
+            std::unique_ptr<Item> item;
+            while (queues_[s]->pop(item))
+            {
+                std::string error;
+                try
+                {
+                    stages_[s].work(worker, *item);
+                }
+                catch (const std::exception &e)
+                { // A failed item must not take the stage down with it
+                    error = e.what();
+                }
+                catch (...)
+                {
+                    error = "unknown error";
+                }
+                if (error.empty() && !last)
+                {
+                    queues_[s + 1]->push(std::move(item));
+                    continue;
+                }
+                if (!error.empty())
+                    std::cerr << "Pipeline " << stages_[s].name << " failed: " << error << std::endl;
+                try
+                {
+                    finish_(worker, *item, error);
+                }
+                catch (const std::exception &e)
+                {
+                    std::cerr << "Pipeline finish failed: " << e.what() << std::endl;
+                }
+                catch (...)
+                {
+                    std::cerr << "Pipeline finish failed." << std::endl;
+                }
+                item.reset();
+            }
+        }
+    };
+
+} // namespace PaddleOCR
+
+#endif // STAGE_RUNNER_H
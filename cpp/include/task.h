@@ -14,6 +14,7 @@ namespace PaddleOCR
 // Recognition successful
 #define CODE_OK 100      // Success, and text recognized
 #define CODE_OK_NONE 101 // Success, and no text recognized
+#define CODE_OK_PARTIAL 102 // Streamed record of a request with "stream", more records and the final response follow
 #define MSG_OK_NONE(p) "No text found in image. Path: \"" + p + "\""
 // Read image by path, failed
 #define CODE_ERR_PATH_EXIST 200 // Image path does not exist
@@ -50,6 +51,22 @@ namespace PaddleOCR
 #define MSG_ERR_BASE64_DECODE "Base64 decode failed."
 #define CODE_ERR_BASE64_IM_DECODE 301 // Base64 string parse successful, but content cannot be decoded by opencv
 #define MSG_ERR_BASE64_IM_DECODE "Base64 data imdecode failed."
+// Read image from raw pixels, failed
+#define CODE_ERR_RAW_PARAM 310 // Raw image width, height, channels or stride missing or invalid
+#define MSG_ERR_RAW_PARAM "Raw image parameters are invalid."
+#define CODE_ERR_RAW_SIZE 311 // Raw image data shorter than its dimensions require
+#define MSG_ERR_RAW_SIZE(n, m) "Raw image data is too short. Expected: " + std::to_string(n) + " bytes, got: " + std::to_string(m)
+#define CODE_ERR_DATA_DECODE 312 // Attached image file cannot be decoded by opencv
+#define MSG_ERR_DATA_DECODE "Attached image data imdecode failed."
+// Read image from shared memory, failed
+#define CODE_ERR_SHM_OPEN 320 // Shared memory segment or file cannot be opened
+#define MSG_ERR_SHM_OPEN(p) "Shared memory open failed. Name: \"" + p + "\""
+#define CODE_ERR_SHM_MAP 321 // Shared memory opened, but cannot be mapped at the given offset
+#define MSG_ERR_SHM_MAP(p) "Shared memory map failed. Name: \"" + p + "\""
+#define CODE_ERR_SHM_DECODE 322 // Shared memory mapped, but content cannot be decoded by opencv
+#define MSG_ERR_SHM_DECODE(p) "Shared memory imdecode failed. Name: \"" + p + "\""
+#define CODE_ERR_FD_NONE 323 // image_fd requested, but no file descriptor was passed with the request
+#define MSG_ERR_FD_NONE "No file descriptor was passed with the request."
 // Json related
 #define CODE_ERR_JSON_DUMP 400 // Json object to string failed
 #define MSG_ERR_JSON_DUMP "Json dump failed."
@@ -59,10 +76,73 @@ namespace PaddleOCR
 #define MSG_ERR_JSON_PARSE_KEY(k) "Json parse key [" + k + "] failed."
 #define CODE_ERR_NO_TASK 403 // No valid task found
 #define MSG_ERR_NO_TASK "No valid tasks."
+#define CODE_ERR_NO_MODEL 404 // Request enables det or rec, but that model was not loaded at startup
+#define MSG_ERR_NO_MODEL(m) "Request enables " + std::string(m) + ", but its model was not loaded at startup."
+// Framed protocol related
+#define CODE_ERR_FRAME_SIZE 410 // Frame length header exceeds max_frame_mb
+#define MSG_ERR_FRAME_SIZE(n) "Frame length exceeds limit. Length: " + std::to_string(n)
+#define CODE_ERR_FORMAT_UNFRAMED 411 // Binary result format requested, but responses are separated by line breaks
+#define MSG_ERR_FORMAT_UNFRAMED(f) "Result format " + std::string(f) + " needs framed responses: -framed, HTTP, or a socket connection without keep_alive."
+// Server related
+#define CODE_ERR_BUSY 500 // Request queue is full, request was not processed
+#define MSG_ERR_BUSY(n) "Server busy, request queue is full. Queue depth: " + std::to_string(n)
+#define CODE_ERR_TIMEOUT 501 // deadline_ms passed during OCR, data holds the text recognized until then
+#define MSG_ERR_TIMEOUT "Deadline passed before OCR finished, data holds the text recognized until then."
+#define CODE_ERR_OCR_FAILED 502 // OCR of the request failed unexpectedly, see the engine log
+#define MSG_ERR_OCR_FAILED(e) "OCR failed: " + std::string(e)
+
+    struct JsonMember; // One member of a request json object, see task.cpp
+
+    // One image of a batch request
+    struct OCRImage
+    {
+        cv::Mat img;                   // Empty when reading failed
+        int code = CODE_INIT;          // Read status code and message
+        std::string msg;
+        std::string path;              // Image path for output when no text
+        std::shared_ptr<void> mapping; // Shared memory mapping the pixels may point into
+        std::function<cv::Mat()> full_loader; // Decodes the full resolution image when img is a reduced decode, see reduced_decode_mp
+    };
+
+    // Parameters a request may override for itself. Default to the startup flags, see Task::default_params()
+    struct OCRParams
+    {
+        bool det = true;
+        bool rec = true;
+        bool cls = true;
+        bool det_override = false;   // det_params differ from the startup flags
+        DBDetectorParams det_params; // Resize and post-processing parameters of detection
+        std::vector<cv::Rect> rois;  // Regions of interest, empty for the whole image
+    };
+
+    // Encoding of the response, chosen per request with "format"
+    enum ResultFormat
+    {
+        FORMAT_JSON,    // Json text, the default
+        FORMAT_MSGPACK, // MessagePack
+        FORMAT_CBOR     // CBOR
+    };
+
+    // One request read and decoded ahead of OCR, see pipelined pipe mode
+    struct OCRRequest
+    {
+        std::string payload;           // Request text, raw pixels of image_raw point into it
+        OCRImage image;                // Single image and its read status
+        bool batch = false;            // Request is a batch of images
+        std::vector<OCRImage> images;  // Batch images
+        std::string id;                // Client supplied request id as json text, empty when absent
+        std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::time_point::max(); // From deadline_ms
+        bool bulk = false;             // Request asked for the bulk lane ("priority": "bulk")
+        OCRParams params;              // Parameters of this request
+        ResultFormat format = FORMAT_JSON; // Response encoding
+        bool stream = false;           // Request asked for streamed records ("stream": true)
+    };
 
     // ==================== Task calling class ====================
     class Task
     {
+        friend class TaskPool; // Worker pool runs requests on its own Task instances
+        friend class StagePipeline; // Stage threads run on their own Task instances
 
     public:
         int ocr(); // OCR image
@@ -72,29 +152,76 @@ namespace PaddleOCR
         std::unique_ptr<PPOCR> ppocr; // OCR engine smart pointer
         int t_code;                   // Current round task status code
         std::string t_msg;            // Current round task status message
+        std::string t_path;           // Current round image path, "base64" for base64 images
+        bool t_keep_alive = false;    // Current round request asked to keep the socket connection open
+        std::shared_ptr<void> t_mapping; // Current round shared memory mapping, image pixels may point into it
+        std::function<cv::Mat()> t_full_loader; // Current round full resolution decode, set when the image was decoded reduced
+        int t_fd = -1;                   // Current round file descriptor passed along with the request over a unix socket
+        bool t_batch = false;            // Current round request is a batch of images ("images")
+        std::vector<OCRImage> t_images;  // Current round batch images
+        std::string t_id;                // Current round request id as json text, echoed in the response
+        std::chrono::steady_clock::time_point t_received; // Arrival of the next request if it waited before being read, deadline_ms counts from it
+        std::chrono::steady_clock::time_point t_deadline = std::chrono::steady_clock::time_point::max(); // Current round deadline from deadline_ms
+        bool t_bulk = false;             // Current round request asked for the bulk lane
+        OCRParams t_params = default_params(); // Current round OCR parameters, with the overrides of the request
+        ResultFormat t_format = FORMAT_JSON; // Current round response encoding
+        bool t_stream = false;           // Current round request asked for streamed records
+        std::function<void(std::string)> t_stream_sink; // Sends a streamed record ahead of the response, set by modes that can
+        std::string t_json;              // Output buffer of the result serializer, keeps its capacity across rounds
 
         // Task flow
         void init_engine();               // Initialize OCR engine
+        void clone_engine(const Task &, bool det = true, bool cls = true, bool rec = true); // Initialize OCR engine as a clone of (the given models of) another task's engine
         void memory_check_cleanup();        // Check memory usage, release memory when reaching limit
-        std::string run_ocr(std::string); // Input user passed value (string), return result json string
+        std::string run_ocr(std::string &); // Input user passed value (string), return result json string
+        std::string run_image(cv::Mat &);   // OCR the image (or batch) read for the current round, return result json string
+        std::string run_ocr_batch();        // OCR the images of a batch request together, return result json string
+        void read_request(OCRRequest &);    // Parse and decode the request payload, move the round state into it
+        std::string run_request(OCRRequest &); // OCR a request decoded by read_request, return result json string
         int single_image_mode();          // Single recognition mode
         int socket_mode();                // Socket mode
         int anonymous_pipe_mode();        // Anonymous pipe mode
+        int pipelined_pipe_mode();        // Anonymous pipe mode, decoding ahead and answering requests as they finish
+        int batch_mode();                 // OCR all images of image_dir or manifest, write JSON lines
         int get_memory_mb();           // Get current memory usage. Return integer in MB. Return -1 on failure.
 
         // Output related
         void set_state(int code = CODE_INIT, std::string msg = "");             // Set state
         std::string get_state_json(int code = CODE_INIT, std::string msg = ""); // Get state json string
-        std::string get_ocr_result_json(const std::vector<OCRPredictResult> &); // Input OCR result, return json string
+        size_t write_ocr_result(std::string &, const std::vector<OCRPredictResult> &, int); // Append OCR result json with the code to a buffer, return the number of text lines
+        bool is_output_line(const OCRPredictResult &);                                      // Whether a line goes into the result
+        void write_ocr_line(std::string &, const OCRPredictResult &, int index, bool text);  // Append the json of one text line to a buffer
+        size_t write_ocr_result_bin(std::string &, const std::vector<OCRPredictResult> &, int); // Same as write_ocr_result in the binary format of the current round
+        void write_ocr_line_bin(std::string &, const OCRPredictResult &, int index, bool text);  // Same as write_ocr_line in the binary format of the current round
+        void write_state_bin(std::string &, int code, const std::string &msg);                  // Append a state map in the binary format of the current round
+        void stream_lines(const std::vector<OCRPredictResult> &, const std::vector<int> &, bool detected); // Send lines found so far as a streamed record
+        std::string get_ocr_result_json(const std::vector<OCRPredictResult> &, bool timeout = false); // Input OCR result, return json string, empty when no text. Timeout json if the call ran out of time
+        std::string get_ocr_result_bin(const std::vector<OCRPredictResult> &, bool timeout = false);  // Same as get_ocr_result_json in the binary format of the current round
+        static bool is_bulk_request(const std::string &); // Check the priority of a request without decoding it
+        static bool is_keep_alive_request(const std::string &); // Check keep_alive of a request without decoding it
+        static OCRParams default_params();                // OCR parameters given by the startup flags
+        std::string result_key(const cv::Mat &);          // Result cache key of an image with the current round parameters
+        bool read_param(const std::string &, const nlohmann::json &); // Apply a parameter override of the request, false if the key is no parameter
+        std::string add_response_field(std::string, const char *, const std::string &); // Append a member (given as json) to a response
+        std::string encode_response(std::string, bool framed);                          // Encode a response in the format of the current round
+        static const char *format_content_type(ResultFormat);                            // Media type of a response format
 
         // Input related
         std::string json_dump(nlohmann::json);                             // Json object to string
         cv::Mat imread_json(std::string &);                                // Input json string, parse json and return image Mat
-        cv::Mat imread_u8(std::string path, int flag = cv::IMREAD_COLOR);  // Replace cv imread, input utf-8 string, return Mat. Set error code on failure and return empty Mat.
+        bool imread_member(const JsonMember &, char *, size_t, cv::Mat &, bool reduce = false); // Read the image named by one request member, false if it is not an image key
+        void imread_batch(const JsonMember &, char *, size_t);             // Read the images of a batch request into t_images
+        cv::Mat imread_u8(std::string path, int flag = cv::IMREAD_COLOR, bool reduce = false); // Replace cv imread, input utf-8 string, return Mat. Set error code on failure and return empty Mat.
         cv::Mat imread_clipboard(int flag = cv::IMREAD_COLOR);             // Read image from current clipboard
-        cv::Mat imread_base64(std::string &, int flag = cv::IMREAD_COLOR); // Input base64 encoded string, return Mat
+        cv::Mat imread_base64(const char *, size_t, int flag = cv::IMREAD_COLOR, bool reduce = false); // Input base64 encoded string, return Mat
+        cv::Mat imdecode_reducible(const char *, size_t, int flag, bool reduce, std::shared_ptr<const void> owner); // Decode image file data, reduced for detection when it is a huge JPEG and reduce is set
+        cv::Mat imread_raw(const nlohmann::json &, char *, size_t);       // Input raw pixel description and pixel data, wrap as Mat without decoding
+        cv::Mat imread_mapped(const nlohmann::json &, char *, size_t);    // Input mapped memory, wrap raw pixels or decode image file
+        cv::Mat imread_shm(const nlohmann::json &);                        // Input shared memory description, map segment and return Mat
 #ifdef _WIN32
-        cv::Mat imread_wstr(std::wstring pathW, int flags = cv::IMREAD_COLOR); // Input unicode wstring, return Mat.
+        cv::Mat imread_wstr(std::wstring pathW, int flags = cv::IMREAD_COLOR, bool reduce = false); // Input unicode wstring, return Mat.
+#else
+        cv::Mat imread_fd(int fd, const nlohmann::json &); // Map file descriptor and return Mat
 #endif
 
         // Other
@@ -0,0 +1,56 @@
+// PaddleOCR-json
+// https://github.com/hiroi-sora/PaddleOCR-json
+
+#ifndef TASK_POOL_H
+#define TASK_POOL_H
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace PaddleOCR
+{
+    class Task;
+
+    // ==================== OCR worker pool ====================
+    // Every worker thread owns one Task. Worker 0 is the base task itself,
+    // the others get a clone of its engine (predictors share the model weights).
+    // Jobs wait in two lanes. Interactive jobs are always served first, also between the stages of a
+    // bulk job that is already running (see PPOCR::set_stage_hook). While both lanes wait, bulk gets
+    // bulk_share percent of the turns, so that it is not starved.
+    class TaskPool
+    {
+    public:
+        typedef std::function<void(Task &)> Job; // Work item, runs on the Task of a free worker
+
+        TaskPool(Task &base, int num_workers, int bulk_share = 0); // Start num_workers workers, base is used as the first one
+        ~TaskPool();                           // Finish queued jobs, then stop and join all workers
+
+        void submit(Job job, bool bulk = false); // Queue a job for the next free worker, in the bulk or the interactive lane
+        int size() const;                        // Number of workers
+        int queued() const;                      // Number of jobs waiting for a free worker, both lanes
+
+    private:
+        std::vector<std::unique_ptr<Task>> clones_; // Worker tasks owned by the pool
+        std::vector<std::thread> threads_;          // One thread per worker
+        std::deque<Job> jobs_;                      // Pending interactive jobs, FIFO
+        std::deque<Job> bulk_jobs_;                 // Pending bulk jobs, FIFO
+        int bulk_share_;                            // Percentage of contended turns given to bulk
+        int bulk_credit_ = 0;                       // Accumulates bulk_share_ per contended turn, bulk's turn at 100
+        mutable std::mutex mutex_;
+        std::condition_variable cond_;
+        bool stopping_ = false;
+
+        void worker_loop(Task &worker);                 // Worker thread body
+        bool bulk_turn();                               // Decide a turn contended by both lanes, with mutex_ held
+        void serve_interactive(Task &worker, Task &guest); // Between stages of a bulk job: run waiting interactive jobs on its engine
+        static void run_job(Job &job, Task &worker);    // Run a job, reporting its failure
+    };
+
+} // namespace PaddleOCR
+
+#endif // TASK_POOL_H
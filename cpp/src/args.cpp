@@ -22,6 +22,24 @@
 DEFINE_string(image_path, "", "Set image_path to run a single task.");                                                          // If an image path is provided, perform a single OCR task.
 DEFINE_int32(port, -1, "Set to 0 enable random port, set to 1~65535 enables specified port.");                                  // Set to 0 for random port, 1~65535 for specified port. Default enables anonymous pipe mode.
 DEFINE_string(addr, "loopback", "Socket server addr, the value can be 'loopback', 'localhost', 'any', or other IPv4 address."); // Socket server address mode, loopback or any available.
+DEFINE_int32(http_port, -1, "Set to 0 enable random port, set to 1~65535 enables HTTP server on specified port (Linux).");       // Serve POST /ocr over HTTP/1.1. Can run next to the socket server.
+DEFINE_string(unix_socket, "", "Set a path to enable unix domain socket server mode (Linux).");                            // Listen on a unix domain socket instead of TCP/IP. Clients may pass file descriptors.
+DEFINE_int32(workers, 1, "Number of OCR workers in socket and pipelined pipe mode. Each worker runs its own predictors.");     // Socket server parallel OCR workers. Consider lowering cpu_threads when raising this.
+DEFINE_int32(queue_size, 64, "Largest number of requests waiting for an OCR worker in socket and http mode, 0 for no limit."); // Requests beyond it are answered with code 500 right away
+DEFINE_int32(bulk_share, 0, "Percentage of turns given to bulk requests while interactive requests wait, 0~100.");      // With 0, "priority":"bulk" requests only run when no interactive request waits
+DEFINE_int32(cache_mb, 0, "Size of the in-memory result cache in MB, 0 disables it.");                              // Repeated identical images are answered without running OCR again
+DEFINE_int32(reduced_decode_mp, 10, "JPEG images of at least this many megapixels are decoded reduced for detection, 0 disables it."); // Lines are still cropped from the full resolution image
+DEFINE_int32(keep_alive_timeout, 30, "Seconds a keep-alive socket connection may stay idle before it is closed.");                // Idle timeout of socket connections whose requests set "keep_alive"
+DEFINE_bool(framed, false, "Prefix every request and response with a 4-byte big-endian length in socket and pipe mode."); // Length-prefixed binary framing instead of line terminators
+DEFINE_int32(max_frame_mb, 256, "Largest accepted request frame in MB.");                                                   // Frames with a longer length header are rejected
+DEFINE_bool(pipeline, false, "Pipe mode reads and decodes ahead, responses return in completion order with the request id."); // Several requests in flight over one pipe, matched by "id"
+DEFINE_string(image_dir, "", "Set a directory to OCR all images in it, results are written as JSON lines.");              // Batch mode, one process for many files
+DEFINE_string(manifest, "", "Set a text file with one image path per line to OCR them all, results are written as JSON lines."); // Batch mode over a file list
+DEFINE_string(batch_output, "", "JSON lines result file of image_dir or manifest batch mode, empty for stdout.");      // One result per line, with the image path
+DEFINE_int32(prefetch, 8, "Number of images batch mode decodes ahead of the OCR workers.");                           // Bounds the memory of decoded images waiting for a worker
+DEFINE_int32(decode_threads, 2, "Number of image decoding threads in batch mode.");                                   // Decoding overlaps with OCR
+DEFINE_string(output_order, "input", "Order of batch mode results, 'input' or 'completion'.");                       // completion: write each result as soon as it is ready
+DEFINE_bool(stage_pipeline, false, "Batch mode runs det, cls and rec on threads of their own, overlapping the stages of consecutive images."); // workers sets the threads per stage
 
 // common args
 DEFINE_bool(use_gpu, false, "Infering with GPU or CPU.");                                              // Enable GPU if true (requires inference library support)
@@ -231,5 +249,17 @@ std::string check_flags()
     {
         msg += "limit_type should be 'slow'(default) or 'fast', not " + FLAGS_det_db_score_mode + ". ";
     }
+    if (FLAGS_output_order != "input" && FLAGS_output_order != "completion")
+    {
+        msg += "output_order should be 'input'(default) or 'completion', not " + FLAGS_output_order + ". ";
+    }
+    if (!FLAGS_image_dir.empty())
+    { // Check batch mode input
+        check_path(FLAGS_image_dir, "image_dir", msg);
+    }
+    if (!FLAGS_manifest.empty())
+    {
+        check_path(FLAGS_manifest, "manifest", msg);
+    }
     return msg;
 }
\ No newline at end of file
@@ -0,0 +1,232 @@
+// PaddleOCR-json
+// https://github.com/hiroi-sora/PaddleOCR-json
+
+#include "include/base64_fast.h"
+
+// SIMD decoding is available on x86. Functions are compiled for their instruction set with target attributes
+// and only called after checking the CPU at runtime, so the rest of the program needs no extra compiler flags.
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define BASE64_X86
+#include <immintrin.h>
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#define BASE64_TARGET(t)
+#else
+#define BASE64_TARGET(t) __attribute__((target(t)))
+#endif
+#endif
+
+// Value of each base64 char, 255 for chars outside both alphabets
+static const unsigned char kDecodeTable[256] = {
+    255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255,
+    255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255,
+    255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255,  62, 255,  62, 255,  63,
+     52,  53,  54,  55,  56,  57,  58,  59,  60,  61, 255, 255, 255, 255, 255, 255,
+    255,   0,   1,   2,   3,   4,   5,   6,   7,   8,   9,  10,  11,  12,  13,  14,
+     15,  16,  17,  18,  19,  20,  21,  22,  23,  24,  25, 255, 255, 255, 255,  63,
+    255,  26,  27,  28,  29,  30,  31,  32,  33,  34,  35,  36,  37,  38,  39,  40,
+     41,  42,  43,  44,  45,  46,  47,  48,  49,  50,  51, 255, 255, 255, 255, 255,
+    255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255,
+    255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255,
+    255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255,
+    255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255,
+    255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255,
+    255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255,
+    255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255,
+    255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255,
+};
+
+// Strip up to two padding chars from the end
+static size_t strip_padding(const char *src, size_t length)
+{
+    for (int i = 0; i < 2 && length > 0 && (src[length - 1] == '=' || src[length - 1] == '.'); i++)
+        length--;
+    return length;
+}
+
+// Scalar decoding of length chars without padding, length % 4 != 1
+static bool decode_scalar(const unsigned char *in, size_t length, unsigned char *dst)
+{
+    // Full chunks: 4 chars to 3 bytes
+    const unsigned char *in_end = in + length / 4 * 4;
+    for (; in < in_end; in += 4, dst += 3)
+    {
+        unsigned int a = kDecodeTable[in[0]], b = kDecodeTable[in[1]], c = kDecodeTable[in[2]], d = kDecodeTable[in[3]];
+        if ((a | b | c | d) & 0x80)
+            return false;
+        unsigned int v = (a << 18) | (b << 12) | (c << 6) | d;
+        dst[0] = static_cast<unsigned char>(v >> 16);
+        dst[1] = static_cast<unsigned char>(v >> 8);
+        dst[2] = static_cast<unsigned char>(v);
+    }
+
+    // Last chunk without padding: 2 chars to 1 byte, 3 chars to 2 bytes
+    size_t tail = length % 4;
+    if (tail > 1)
+    {
+        unsigned int a = kDecodeTable[in[0]], b = kDecodeTable[in[1]], c = tail == 3 ? kDecodeTable[in[2]] : 0;
+        if ((a | b | c) & 0x80)
+            return false;
+        unsigned int v = (a << 18) | (b << 12) | (c << 6);
+        dst[0] = static_cast<unsigned char>(v >> 16);
+        if (tail == 3)
+            dst[1] = static_cast<unsigned char>(v >> 8);
+    }
+    return true;
+}
+
+// SIMD decoders translate whole blocks of the standard alphabet and return the number of chars done, a multiple of 4.
+// They stop at the first block with any other char, and leave the rest, including the url-safe alphabet and
+// error reporting, to decode_scalar(). Each block stores a full register, so they also stop while fewer than
+// a register's worth of output bytes remain.
+//
+// Per char, the high nibble picks a class from lut_hi and the low nibble a set of classes it is invalid in from lut_lo,
+// so (lut_lo & lut_hi) != 0 marks invalid chars. lut_roll then maps each class to the offset from ASCII to its 6-bit
+// value ('/' gets its own entry through the comparison with 0x2F). Finally multiply-adds pack 4 x 6 bits into 3 bytes.
+// See Wojciech Mula and Daniel Lemire, "Faster Base64 Encoding and Decoding Using AVX2 Instructions".
+#ifdef BASE64_X86
+BASE64_TARGET("ssse3,sse4.1")
+static size_t decode_sse41(const unsigned char *in, size_t length, unsigned char *dst)
+{
+    const __m128i lut_lo = _mm_setr_epi8(0x15, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11,
+                                         0x11, 0x11, 0x13, 0x1A, 0x1B, 0x1B, 0x1B, 0x1A);
+    const __m128i lut_hi = _mm_setr_epi8(0x10, 0x10, 0x01, 0x02, 0x04, 0x08, 0x04, 0x08,
+                                         0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10);
+    const __m128i lut_roll = _mm_setr_epi8(0, 16, 19, 4, -65, -65, -71, -71, 0, 0, 0, 0, 0, 0, 0, 0);
+    const __m128i mask_2F = _mm_set1_epi8(0x2F);
+    const __m128i pack_shuffle = _mm_setr_epi8(2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1);
+
+    size_t done = 0;
+    while (length - done >= 24) // 16 chars in, 16 bytes stored
+    {
+        __m128i str = _mm_loadu_si128(reinterpret_cast<const __m128i *>(in + done));
+        __m128i hi_nibbles = _mm_and_si128(_mm_srli_epi32(str, 4), mask_2F);
+        __m128i lo_nibbles = _mm_and_si128(str, mask_2F);
+        __m128i hi = _mm_shuffle_epi8(lut_hi, hi_nibbles);
+        __m128i lo = _mm_shuffle_epi8(lut_lo, lo_nibbles);
+        if (!_mm_testz_si128(lo, hi))
+            break;
+        __m128i eq_2F = _mm_cmpeq_epi8(str, mask_2F);
+        __m128i roll = _mm_shuffle_epi8(lut_roll, _mm_add_epi8(eq_2F, hi_nibbles));
+        str = _mm_add_epi8(str, roll);
+        // 4 x 6 bits -> 2 x 12 bits -> 24 bits per 32-bit lane, then gather the 3 bytes of each lane
+        __m128i merged = _mm_maddubs_epi16(str, _mm_set1_epi32(0x01400140));
+        __m128i out = _mm_madd_epi16(merged, _mm_set1_epi32(0x00011000));
+        out = _mm_shuffle_epi8(out, pack_shuffle);
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + done / 4 * 3), out);
+        done += 16;
+    }
+    return done;
+}
+
+BASE64_TARGET("avx2")
+static size_t decode_avx2(const unsigned char *in, size_t length, unsigned char *dst)
+{
+    const __m256i lut_lo = _mm256_setr_epi8(0x15, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11,
+                                            0x11, 0x11, 0x13, 0x1A, 0x1B, 0x1B, 0x1B, 0x1A,
+                                            0x15, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11,
+                                            0x11, 0x11, 0x13, 0x1A, 0x1B, 0x1B, 0x1B, 0x1A);
+    const __m256i lut_hi = _mm256_setr_epi8(0x10, 0x10, 0x01, 0x02, 0x04, 0x08, 0x04, 0x08,
+                                            0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10,
+                                            0x10, 0x10, 0x01, 0x02, 0x04, 0x08, 0x04, 0x08,
+                                            0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10);
+    const __m256i lut_roll = _mm256_setr_epi8(0, 16, 19, 4, -65, -65, -71, -71, 0, 0, 0, 0, 0, 0, 0, 0,
+                                              0, 16, 19, 4, -65, -65, -71, -71, 0, 0, 0, 0, 0, 0, 0, 0);
+    const __m256i mask_2F = _mm256_set1_epi8(0x2F);
+    const __m256i pack_shuffle = _mm256_setr_epi8(2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1,
+                                                  2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1);
+    const __m256i pack_lanes = _mm256_setr_epi32(0, 1, 2, 4, 5, 6, -1, -1);
+
+    size_t done = 0;
+    while (length - done >= 44) // 32 chars in, 32 bytes stored
+    {
+        __m256i str = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(in + done));
+        __m256i hi_nibbles = _mm256_and_si256(_mm256_srli_epi32(str, 4), mask_2F);
+        __m256i lo_nibbles = _mm256_and_si256(str, mask_2F);
+        __m256i hi = _mm256_shuffle_epi8(lut_hi, hi_nibbles);
+        __m256i lo = _mm256_shuffle_epi8(lut_lo, lo_nibbles);
+        if (!_mm256_testz_si256(lo, hi))
+            break;
+        __m256i eq_2F = _mm256_cmpeq_epi8(str, mask_2F);
+        __m256i roll = _mm256_shuffle_epi8(lut_roll, _mm256_add_epi8(eq_2F, hi_nibbles));
+        str = _mm256_add_epi8(str, roll);
+        __m256i merged = _mm256_maddubs_epi16(str, _mm256_set1_epi32(0x01400140));
+        __m256i out = _mm256_madd_epi16(merged, _mm256_set1_epi32(0x00011000));
+        out = _mm256_shuffle_epi8(out, pack_shuffle);
+        out = _mm256_permutevar8x32_epi32(out, pack_lanes); // 12 bytes of each 128-bit lane next to each other
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(dst + done / 4 * 3), out);
+        done += 32;
+    }
+    return done;
+}
+
+// Best SIMD level supported by the CPU and operating system
+static Base64Simd detect_simd()
+{
+#if defined(_MSC_VER) && !defined(__clang__)
+    int info[4];
+    __cpuid(info, 0);
+    int max_leaf = info[0];
+    __cpuid(info, 1);
+    bool sse41 = (info[2] & (1 << 19)) != 0;
+    bool os_avx = (info[2] & (1 << 27)) != 0 && (info[2] & (1 << 28)) != 0 && (_xgetbv(0) & 6) == 6; // OSXSAVE, AVX, YMM state enabled
+    bool avx2 = false;
+    if (max_leaf >= 7)
+    {
+        __cpuidex(info, 7, 0);
+        avx2 = os_avx && (info[1] & (1 << 5)) != 0;
+    }
+#else
+    __builtin_cpu_init();
+    bool sse41 = __builtin_cpu_supports("sse4.1");
+    bool avx2 = __builtin_cpu_supports("avx2");
+#endif
+    if (avx2)
+        return BASE64_AVX2;
+    if (sse41)
+        return BASE64_SSE41;
+    return BASE64_SCALAR;
+}
+#endif
+
+Base64Simd base64_simd_support()
+{
+#ifdef BASE64_X86
+    static const Base64Simd level = detect_simd();
+    return level;
+#else
+    return BASE64_SCALAR;
+#endif
+}
+
+size_t base64_decoded_length(const char *src, size_t length)
+{
+    length = strip_padding(src, length);
+    size_t tail = length % 4;
+    return length / 4 * 3 + (tail > 1 ? tail - 1 : 0);
+}
+
+bool base64_decode_into(const char *src, size_t length, unsigned char *dst, Base64Simd simd)
+{
+    const unsigned char *in = reinterpret_cast<const unsigned char *>(src);
+    length = strip_padding(src, length);
+    if (length % 4 == 1) // A single char cannot encode a byte
+        return false;
+
+    // Bulk of the string with SIMD, the rest with the scalar decoder
+    size_t done = 0;
+#ifdef BASE64_X86
+    if (simd > base64_simd_support())
+        simd = base64_simd_support();
+    if (simd == BASE64_AVX2)
+        done = decode_avx2(in, length, dst);
+    else if (simd == BASE64_SSE41)
+        done = decode_sse41(in, length, dst);
+#endif
+    return decode_scalar(in + done, length - done, dst + done / 4 * 3);
+}
+
+bool base64_decode_into(const char *src, size_t length, unsigned char *dst)
+{
+    return base64_decode_into(src, length, dst, base64_simd_support());
+}
@@ -0,0 +1,91 @@
+// PaddleOCR-json
+// https://github.com/hiroi-sora/PaddleOCR-json
+
+#include "include/batch_io.h"
+
+#include <algorithm>
+#include <cctype>
+
+#include "include/nlohmann/json.hpp"
+
+namespace PaddleOCR
+{
+    bool is_image_file(const std::string &name)
+    {
+        size_t dot = name.rfind('.');
+        if (dot == std::string::npos)
+            return false;
+        std::string ext = name.substr(dot + 1);
+        std::transform(ext.begin(), ext.end(), ext.begin(), [](unsigned char c)
+                       { return static_cast<char>(std::tolower(c)); });
+        static const char *const exts[] = {"jpg", "jpeg", "jpe", "png", "bmp", "dib", "tif", "tiff",
+                                           "webp", "jp2", "pbm", "pgm", "ppm", "pnm"};
+        for (const char *e : exts)
+        {
+            if (ext == e)
+                return true;
+        }
+        return false;
+    }
+
+    std::vector<std::string> read_manifest(std::istream &in)
+    {
+        std::vector<std::string> paths;
+        std::string line;
+        while (std::getline(in, line))
+        {
+            if (!line.empty() && line.back() == '\r')
+                line.pop_back();
+            if (!line.empty())
+                paths.push_back(line);
+        }
+        return paths;
+    }
+
+    std::string batch_path_json(const std::string &path, bool ensure_ascii)
+    {
+        return nlohmann::json(path).dump(-1, ' ', ensure_ascii, nlohmann::json::error_handler_t::replace);
+    }
+
+    std::string batch_error_line(int code, const std::string &msg, const std::string &path, bool ensure_ascii)
+    {
+        nlohmann::json j;
+        j["code"] = code;
+        j["data"] = msg;
+        j["path"] = path;
+        return j.dump(-1, ' ', ensure_ascii, nlohmann::json::error_handler_t::replace);
+    }
+
+    BatchWriter::BatchWriter(std::ostream &out, bool input_order) : out_(out), input_order_(input_order) {}
+
+    void BatchWriter::write(size_t index, std::string line)
+    {
+        if (!input_order_)
+        {
+            out_ << line << '\n';
+            return;
+        }
+        // Write this and the following lines that are already done
+        ahead_[index] = std::move(line);
+        while (!ahead_.empty() && ahead_.begin()->first == next_)
+        {
+            out_ << ahead_.begin()->second << '\n';
+            ahead_.erase(ahead_.begin());
+            ++next_;
+        }
+    }
+
+    size_t BatchWriter::held() const
+    {
+        return ahead_.size();
+    }
+
+    void BatchWriter::finish()
+    {
+        for (auto &line : ahead_)
+            out_ << line.second << '\n';
+        ahead_.clear();
+        out_.flush();
+    }
+
+} // namespace PaddleOCR
@@ -0,0 +1,270 @@
+// PaddleOCR-json
+// https://github.com/hiroi-sora/PaddleOCR-json
+
+#include "include/http.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cstdio>
+#include <cstdlib>
+
+namespace PaddleOCR
+{
+    static const size_t HTTP_MAX_HEADER = 64 * 1024; // Longer headers are answered with 431
+    static const size_t HTTP_MAX_CHUNK_LINE = 1024;  // Longer chunk size lines are malformed
+
+    static std::string to_lower(std::string str)
+    {
+        std::transform(str.begin(), str.end(), str.begin(), [](unsigned char c)
+                       { return static_cast<char>(std::tolower(c)); });
+        return str;
+    }
+
+    static std::string trim(const std::string &str)
+    {
+        size_t begin = str.find_first_not_of(" \t");
+        if (begin == std::string::npos)
+            return "";
+        size_t end = str.find_last_not_of(" \t");
+        return str.substr(begin, end - begin + 1);
+    }
+
+    HttpParser::HttpParser(size_t max_body) : max_body_(max_body) {}
+
+    void HttpParser::reset()
+    {
+        scanned_ = 0;
+        header_end_ = 0;
+        pos_ = 0;
+        content_length_ = 0;
+        chunked_ = false;
+        chunks_done_ = false;
+        expect_continue_ = false;
+        request_ = HttpRequest();
+    }
+
+    HttpParser::State HttpParser::fail(int status)
+    {
+        error_ = status;
+        return HTTP_FAILED;
+    }
+
+    int HttpParser::error_status() const
+    {
+        return error_;
+    }
+
+    bool HttpParser::expects_continue()
+    {
+        if (!expect_continue_)
+            return false;
+        expect_continue_ = false; // Answer only once
+        return true;
+    }
+
+    // Parse request line and headers, which end at header_end_
+    HttpParser::State HttpParser::parse_header(const std::string &buffer)
+    {
+        size_t line_end = buffer.find("\r\n");
+        std::string line = buffer.substr(0, line_end);
+        // Request line: method, target, version
+        size_t sp1 = line.find(' ');
+        size_t sp2 = line.rfind(' ');
+        if (sp1 == std::string::npos || sp2 == sp1)
+            return fail(400);
+        request_.method = line.substr(0, sp1);
+        std::string target = line.substr(sp1 + 1, sp2 - sp1 - 1);
+        std::string version = line.substr(sp2 + 1);
+        request_.path = target.substr(0, target.find('?'));
+        if (version == "HTTP/1.1")
+            request_.http_1_1 = true;
+        else if (version == "HTTP/1.0")
+            request_.http_1_1 = false;
+        else
+            return fail(505);
+        request_.keep_alive = request_.http_1_1; // HTTP/1.0 closes unless asked otherwise
+
+        bool has_length = false;
+        std::string expect;
+        while (line_end + 2 < header_end_ - 2)
+        {
+            size_t begin = line_end + 2;
+            line_end = buffer.find("\r\n", begin);
+            line = buffer.substr(begin, line_end - begin);
+            size_t colon = line.find(':');
+            if (colon == std::string::npos)
+                return fail(400);
+            std::string name = to_lower(trim(line.substr(0, colon)));
+            std::string value = trim(line.substr(colon + 1));
+            if (name == "content-length")
+            {
+                if (value.empty() || value.find_first_not_of("0123456789") != std::string::npos || value.length() > 18)
+                    return fail(400);
+                content_length_ = std::strtoull(value.c_str(), nullptr, 10);
+                has_length = true;
+            }
+            else if (name == "transfer-encoding")
+            {
+                if (to_lower(value) != "chunked")
+                    return fail(501);
+                chunked_ = true;
+            }
+            else if (name == "content-type")
+            {
+                request_.content_type = to_lower(trim(value.substr(0, value.find(';'))));
+            }
+            else if (name == "connection")
+            {
+                std::string connection = to_lower(value);
+                if (connection.find("close") != std::string::npos)
+                    request_.keep_alive = false;
+                else if (connection.find("keep-alive") != std::string::npos)
+                    request_.keep_alive = true;
+            }
+            else if (name == "expect")
+            {
+                expect = to_lower(value);
+            }
+        }
+        if (chunked_ && has_length)
+            return fail(400); // Ambiguous body length
+        if (!chunked_ && content_length_ > max_body_)
+            return fail(413);
+        expect_continue_ = expect == "100-continue";
+        pos_ = header_end_;
+        return HTTP_COMPLETE;
+    }
+
+    // Decode the chunks received so far into the request body
+    HttpParser::State HttpParser::parse_chunks(const std::string &buffer)
+    {
+        while (!chunks_done_)
+        {
+            size_t line_end = buffer.find("\r\n", pos_);
+            if (line_end == std::string::npos)
+                return buffer.length() - pos_ > HTTP_MAX_CHUNK_LINE ? fail(400) : HTTP_INCOMPLETE;
+            char *end;
+            unsigned long long size = std::strtoull(buffer.c_str() + pos_, &end, 16);
+            if (end == buffer.c_str() + pos_ || line_end - pos_ > HTTP_MAX_CHUNK_LINE)
+                return fail(400);
+            if (size > max_body_ - std::min(max_body_, request_.body.length()))
+                return fail(413);
+            if (size == 0)
+            { // Last chunk, the trailer follows
+                chunks_done_ = true;
+                pos_ = line_end;
+                break;
+            }
+            size_t data = line_end + 2;
+            if (buffer.length() < data + size + 2)
+                return HTTP_INCOMPLETE;
+            if (buffer.compare(data + size, 2, "\r\n") != 0)
+                return fail(400);
+            request_.body.append(buffer, data, size);
+            pos_ = data + size + 2;
+        }
+        // Trailer fields are ignored, the body ends with an empty line
+        size_t trailer_end = buffer.find("\r\n\r\n", pos_);
+        if (trailer_end == std::string::npos)
+            return buffer.length() - pos_ > HTTP_MAX_HEADER ? fail(431) : HTTP_INCOMPLETE;
+        pos_ = trailer_end + 4;
+        return HTTP_COMPLETE;
+    }
+
+    HttpParser::State HttpParser::parse(std::string &buffer, HttpRequest &request)
+    {
+        if (header_end_ == 0)
+        {
+            // Search for the blank line that ends the header, going back 3 bytes in case it was split across reads
+            size_t end = buffer.find("\r\n\r\n", scanned_ >= 3 ? scanned_ - 3 : 0);
+            if (end == std::string::npos)
+            {
+                scanned_ = buffer.length();
+                return buffer.length() > HTTP_MAX_HEADER ? fail(431) : HTTP_INCOMPLETE;
+            }
+            if (end + 4 > HTTP_MAX_HEADER)
+                return fail(431);
+            header_end_ = end + 4;
+            State state = parse_header(buffer);
+            if (state != HTTP_COMPLETE)
+                return state;
+        }
+
+        size_t consumed;
+        if (chunked_)
+        {
+            State state = parse_chunks(buffer);
+            if (state != HTTP_COMPLETE)
+                return state;
+            consumed = pos_;
+        }
+        else
+        {
+            if (buffer.length() < header_end_ + content_length_)
+            {
+                buffer.reserve(header_end_ + content_length_); // Body size is known, grow the buffer once
+                return HTTP_INCOMPLETE;
+            }
+            request_.body.assign(buffer, header_end_, content_length_);
+            consumed = header_end_ + content_length_;
+        }
+        expect_continue_ = false; // Body is already here
+        buffer.erase(0, consumed);
+        request = std::move(request_);
+        reset();
+        return HTTP_COMPLETE;
+    }
+
+    const char *http_reason(int status)
+    {
+        switch (status)
+        {
+        case 100:
+            return "Continue";
+        case 200:
+            return "OK";
+        case 400:
+            return "Bad Request";
+        case 404:
+            return "Not Found";
+        case 405:
+            return "Method Not Allowed";
+        case 413:
+            return "Payload Too Large";
+        case 431:
+            return "Request Header Fields Too Large";
+        case 501:
+            return "Not Implemented";
+        case 503:
+            return "Service Unavailable";
+        case 505:
+            return "HTTP Version Not Supported";
+        default:
+            return "Unknown";
+        }
+    }
+
+    std::string http_head(int status, const std::string &content_type, bool keep_alive, bool chunked, size_t content_length)
+    {
+        std::string head = "HTTP/1.1 " + std::to_string(status) + " " + http_reason(status) + "\r\n";
+        head += "Content-Type: " + content_type + "\r\n";
+        if (chunked)
+            head += "Transfer-Encoding: chunked\r\n";
+        else
+            head += "Content-Length: " + std::to_string(content_length) + "\r\n";
+        head += keep_alive ? "Connection: keep-alive\r\n" : "Connection: close\r\n";
+        head += "\r\n";
+        return head;
+    }
+
+    void http_chunk(std::string &out, const char *data, size_t length)
+    {
+        char size[20];
+        int n = snprintf(size, sizeof(size), "%zx\r\n", length);
+        out.append(size, n);
+        if (length > 0)
+            out.append(data, length);
+        out.append("\r\n");
+    }
+
+} // namespace PaddleOCR
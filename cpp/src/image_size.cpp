@@ -0,0 +1,73 @@
+// PaddleOCR-json
+// https://github.com/hiroi-sora/PaddleOCR-json
+
+#include "include/image_size.h"
+
+#include <algorithm>
+#include <limits>
+
+namespace PaddleOCR
+{
+    bool jpeg_size(const unsigned char *data, size_t length, int &width, int &height)
+    {
+        if (length < 4 || data[0] != 0xFF || data[1] != 0xD8)
+            return false;
+        size_t pos = 2;
+        while (pos + 4 <= length)
+        {
+            if (data[pos] != 0xFF)
+                return false;
+            unsigned char marker = data[pos + 1];
+            if (marker == 0xFF)
+            { // Fill byte
+                pos++;
+                continue;
+            }
+            if (marker == 0x01 || (marker >= 0xD0 && marker <= 0xD7))
+            { // Markers without a segment
+                pos += 2;
+                continue;
+            }
+            if (marker == 0xD9 || marker == 0xDA)
+                return false; // End of image or start of scan before any frame header
+            size_t segment = (static_cast<size_t>(data[pos + 2]) << 8) | data[pos + 3];
+            if (segment < 2)
+                return false;
+            // Start of frame: SOF0-SOF15, except DHT (C4), JPG (C8) and DAC (CC)
+            if (marker >= 0xC0 && marker <= 0xCF && marker != 0xC4 && marker != 0xC8 && marker != 0xCC)
+            {
+                if (segment < 7 || pos + 9 > length)
+                    return false;
+                height = (data[pos + 5] << 8) | data[pos + 6];
+                width = (data[pos + 7] << 8) | data[pos + 8];
+                return width > 0 && height > 0;
+            }
+            pos += 2 + segment;
+        }
+        return false;
+    }
+
+    int reduced_decode_scale(int width, int height, const std::string &limit_type, int limit_side_len, int min_megapixels)
+    {
+        if (limit_type != "max" || min_megapixels <= 0 || static_cast<long long>(width) * height < min_megapixels * 1000000LL)
+            return 1;
+        int side = std::max(width, height);
+        int scale = 8;
+        // A reduced JPEG side is rounded up, so side / scale rounded down is a safe lower bound
+        while (scale > 1 && side / scale < limit_side_len)
+            scale /= 2;
+        return scale;
+    }
+
+    size_t raw_image_bytes(size_t row_bytes, int height, size_t stride)
+    {
+        if (height <= 0)
+            return 0;
+        size_t rows = static_cast<size_t>(height) - 1; // Rows before the last one
+        size_t max = std::numeric_limits<size_t>::max();
+        if (row_bytes == max || (rows > 0 && stride > (max - row_bytes) / rows))
+            return max;
+        return stride * rows + row_bytes;
+    }
+
+} // namespace PaddleOCR
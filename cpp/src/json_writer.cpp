@@ -0,0 +1,370 @@
+// PaddleOCR-json
+// https://github.com/hiroi-sora/PaddleOCR-json
+
+#include "include/json_writer.h"
+
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+
+#include "include/nlohmann/json.hpp" // Shortest round-trip float formatting
+
+namespace PaddleOCR
+{
+    static const char HEX_DIGITS[] = "0123456789abcdef";
+
+    // Append \uXXXX with lower case hex digits
+    static void append_u_escape(std::string &out, uint32_t unit)
+    {
+        char buf[6] = {'\\', 'u', HEX_DIGITS[(unit >> 12) & 0xF], HEX_DIGITS[(unit >> 8) & 0xF],
+                       HEX_DIGITS[(unit >> 4) & 0xF], HEX_DIGITS[unit & 0xF]};
+        out.append(buf, 6);
+    }
+
+    // Decode the UTF-8 sequence starting at p. Return its length, 0 if it is invalid or truncated.
+    // Overlong forms, surrogates and code points above U+10FFFF are invalid.
+    static size_t decode_utf8(const unsigned char *p, const unsigned char *end, uint32_t &codepoint)
+    {
+        unsigned char b = p[0];
+        size_t length;
+        unsigned char low = 0x80, high = 0xBF; // Range of the second byte
+        if (b >= 0xC2 && b <= 0xDF)
+        {
+            length = 2;
+            codepoint = b & 0x1F;
+        }
+        else if (b >= 0xE0 && b <= 0xEF)
+        {
+            length = 3;
+            codepoint = b & 0x0F;
+            if (b == 0xE0)
+                low = 0xA0;
+            else if (b == 0xED)
+                high = 0x9F;
+        }
+        else if (b >= 0xF0 && b <= 0xF4)
+        {
+            length = 4;
+            codepoint = b & 0x07;
+            if (b == 0xF0)
+                low = 0x90;
+            else if (b == 0xF4)
+                high = 0x8F;
+        }
+        else
+        {
+            return 0;
+        }
+        if (static_cast<size_t>(end - p) < length || p[1] < low || p[1] > high)
+            return 0;
+        for (size_t i = 1; i < length; i++)
+        {
+            if ((p[i] & 0xC0) != 0x80)
+                return 0;
+            codepoint = (codepoint << 6) | (p[i] & 0x3F);
+        }
+        return length;
+    }
+
+    void json_append_string(std::string &out, const std::string &str, bool ensure_ascii)
+    {
+        const unsigned char *begin = reinterpret_cast<const unsigned char *>(str.data());
+        const unsigned char *end = begin + str.size();
+        const unsigned char *p = begin;
+        out.reserve(out.size() + str.size() + 2);
+        out += '"';
+        while (p < end)
+        {
+            // Copy the run of bytes that need no escaping in one go
+            const unsigned char *run = p;
+            while (p < end && *p >= 0x20 && *p != '"' && *p != '\\' && (*p < 0x7F || !ensure_ascii))
+            {
+                if (*p >= 0x80)
+                { // Multi-byte sequences are copied as they are, but must be valid
+                    uint32_t codepoint;
+                    size_t length = decode_utf8(p, end, codepoint);
+                    if (length == 0)
+                        throw std::invalid_argument("invalid UTF-8 byte at index " + std::to_string(p - begin));
+                    p += length;
+                }
+                else
+                {
+                    p++;
+                }
+            }
+            out.append(reinterpret_cast<const char *>(run), p - run);
+            if (p == end)
+                break;
+            // One character that must be escaped
+            unsigned char b = *p;
+            switch (b)
+            {
+            case '\b':
+                out += "\\b";
+                break;
+            case '\t':
+                out += "\\t";
+                break;
+            case '\n':
+                out += "\\n";
+                break;
+            case '\f':
+                out += "\\f";
+                break;
+            case '\r':
+                out += "\\r";
+                break;
+            case '"':
+                out += "\\\"";
+                break;
+            case '\\':
+                out += "\\\\";
+                break;
+            default:
+                if (b < 0x80)
+                { // Other control characters, and DEL with ensure_ascii
+                    append_u_escape(out, b);
+                }
+                else
+                { // Non-ASCII with ensure_ascii, as UTF-16 code units
+                    uint32_t codepoint;
+                    size_t length = decode_utf8(p, end, codepoint);
+                    if (length == 0)
+                        throw std::invalid_argument("invalid UTF-8 byte at index " + std::to_string(p - begin));
+                    if (codepoint <= 0xFFFF)
+                    {
+                        append_u_escape(out, codepoint);
+                    }
+                    else
+                    {
+                        append_u_escape(out, 0xD7C0 + (codepoint >> 10));
+                        append_u_escape(out, 0xDC00 + (codepoint & 0x3FF));
+                    }
+                    p += length;
+                    continue;
+                }
+            }
+            p++;
+        }
+        out += '"';
+    }
+
+    void json_append_int(std::string &out, long long value)
+    {
+        char buf[24];
+        char *q = buf + sizeof(buf);
+        unsigned long long v = value < 0 ? 0ULL - static_cast<unsigned long long>(value) : static_cast<unsigned long long>(value);
+        do
+        {
+            *--q = static_cast<char>('0' + v % 10);
+            v /= 10;
+        } while (v != 0);
+        if (value < 0)
+            *--q = '-';
+        out.append(q, buf + sizeof(buf) - q);
+    }
+
+    void json_append_float(std::string &out, double value)
+    {
+        if (!std::isfinite(value))
+        {
+            out += "null";
+            return;
+        }
+        char buf[64];
+        char *q = nlohmann::detail::to_chars(buf, buf + sizeof(buf), value);
+        out.append(buf, q - buf);
+    }
+
+    // Append the low bytes of v, big endian
+    static void append_big_endian(std::string &out, uint64_t v, int bytes)
+    {
+        for (int i = bytes - 1; i >= 0; i--)
+            out += static_cast<char>((v >> (8 * i)) & 0xFF);
+    }
+
+    // Append a CBOR head: the major type and its argument in the shortest form
+    static void cbor_head(std::string &out, unsigned char major, uint64_t arg)
+    {
+        unsigned char type = static_cast<unsigned char>(major << 5);
+        if (arg <= 23)
+        {
+            out += static_cast<char>(type | arg);
+        }
+        else if (arg <= 0xFF)
+        {
+            out += static_cast<char>(type | 24);
+            append_big_endian(out, arg, 1);
+        }
+        else if (arg <= 0xFFFF)
+        {
+            out += static_cast<char>(type | 25);
+            append_big_endian(out, arg, 2);
+        }
+        else if (arg <= 0xFFFFFFFF)
+        {
+            out += static_cast<char>(type | 26);
+            append_big_endian(out, arg, 4);
+        }
+        else
+        {
+            out += static_cast<char>(type | 27);
+            append_big_endian(out, arg, 8);
+        }
+    }
+
+    // Append a MessagePack array or map header: the fix form up to 15 entries, then 16 or 32 bit lengths
+    static void msgpack_container(std::string &out, unsigned char fix, unsigned char len16, size_t size)
+    {
+        if (size <= 15)
+        {
+            out += static_cast<char>(fix | size);
+        }
+        else if (size <= 0xFFFF)
+        {
+            out += static_cast<char>(len16);
+            append_big_endian(out, size, 2);
+        }
+        else
+        {
+            out += static_cast<char>(len16 + 1);
+            append_big_endian(out, size, 4);
+        }
+    }
+
+    void bin_append_map(std::string &out, bool cbor, size_t size)
+    {
+        if (cbor)
+            cbor_head(out, 5, size);
+        else
+            msgpack_container(out, 0x80, 0xDE, size);
+    }
+
+    void bin_append_array(std::string &out, bool cbor, size_t size)
+    {
+        if (cbor)
+            cbor_head(out, 4, size);
+        else
+            msgpack_container(out, 0x90, 0xDC, size);
+    }
+
+    void bin_append_string(std::string &out, bool cbor, const std::string &str)
+    {
+        const unsigned char *begin = reinterpret_cast<const unsigned char *>(str.data());
+        const unsigned char *end = begin + str.size();
+        for (const unsigned char *p = begin; p < end;)
+        {
+            if (*p < 0x80)
+            {
+                p++;
+                continue;
+            }
+            uint32_t codepoint;
+            size_t length = decode_utf8(p, end, codepoint);
+            if (length == 0)
+                throw std::invalid_argument("invalid UTF-8 byte at index " + std::to_string(p - begin));
+            p += length;
+        }
+        size_t size = str.size();
+        if (cbor)
+        {
+            cbor_head(out, 3, size);
+        }
+        else if (size <= 31)
+        {
+            out += static_cast<char>(0xA0 | size);
+        }
+        else
+        {
+            int bytes = size <= 0xFF ? 1 : size <= 0xFFFF ? 2 : 4;
+            out += static_cast<char>(bytes == 1 ? 0xD9 : bytes == 2 ? 0xDA : 0xDB);
+            append_big_endian(out, size, bytes);
+        }
+        out += str;
+    }
+
+    void bin_append_int(std::string &out, bool cbor, long long value)
+    {
+        if (cbor)
+        {
+            if (value >= 0)
+                cbor_head(out, 0, static_cast<uint64_t>(value));
+            else
+                cbor_head(out, 1, static_cast<uint64_t>(-1 - value));
+            return;
+        }
+        if (value >= 0)
+        {
+            uint64_t v = static_cast<uint64_t>(value);
+            if (v < 0x80)
+            { // Positive fixint
+                out += static_cast<char>(v);
+                return;
+            }
+            int bytes = v <= 0xFF ? 1 : v <= 0xFFFF ? 2 : v <= 0xFFFFFFFF ? 4 : 8;
+            out += static_cast<char>(bytes == 1 ? 0xCC : bytes == 2 ? 0xCD : bytes == 4 ? 0xCE : 0xCF);
+            append_big_endian(out, v, bytes);
+            return;
+        }
+        if (value >= -32)
+        { // Negative fixint
+            out += static_cast<char>(value);
+            return;
+        }
+        int bytes = value >= INT8_MIN ? 1 : value >= INT16_MIN ? 2 : value >= INT32_MIN ? 4 : 8;
+        out += static_cast<char>(bytes == 1 ? 0xD0 : bytes == 2 ? 0xD1 : bytes == 4 ? 0xD2 : 0xD3);
+        append_big_endian(out, static_cast<uint64_t>(value), bytes);
+    }
+
+    void bin_append_float(std::string &out, bool cbor, double value)
+    {
+        if (!std::isfinite(value))
+        {
+            out += static_cast<char>(cbor ? 0xF6 : 0xC0);
+            return;
+        }
+        if (value >= std::numeric_limits<float>::lowest() && value <= std::numeric_limits<float>::max() &&
+            static_cast<double>(static_cast<float>(value)) == value)
+        { // Fits in single precision without loss
+            float single = static_cast<float>(value);
+            uint32_t bits;
+            std::memcpy(&bits, &single, sizeof(bits));
+            out += static_cast<char>(cbor ? 0xFA : 0xCA);
+            append_big_endian(out, bits, 4);
+        }
+        else
+        {
+            uint64_t bits;
+            std::memcpy(&bits, &value, sizeof(bits));
+            out += static_cast<char>(cbor ? 0xFB : 0xCB);
+            append_big_endian(out, bits, 8);
+        }
+    }
+
+    // Map headers with a 16 bit count: CBOR major type 5 with a 2 byte argument, MessagePack map16
+    static const unsigned char CBOR_MAP16 = 0xB9, MSGPACK_MAP16 = 0xDE;
+
+    void bin_begin_response(std::string &out, bool cbor, size_t size)
+    {
+        out += static_cast<char>(cbor ? CBOR_MAP16 : MSGPACK_MAP16);
+        append_big_endian(out, size, 2);
+    }
+
+    bool bin_is_response(const std::string &out)
+    {
+        if (out.size() < 3)
+            return false;
+        unsigned char b = static_cast<unsigned char>(out[0]);
+        return b == CBOR_MAP16 || b == MSGPACK_MAP16;
+    }
+
+    void bin_grow_response(std::string &out)
+    {
+        unsigned size = (static_cast<unsigned char>(out[1]) << 8 | static_cast<unsigned char>(out[2])) + 1;
+        out[1] = static_cast<char>(size >> 8);
+        out[2] = static_cast<char>(size);
+    }
+
+} // namespace PaddleOCR
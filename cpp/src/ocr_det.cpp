@@ -79,8 +79,11 @@ namespace PaddleOCR
 
     void DBDetector::Run(cv::Mat &img,
                          std::vector<std::vector<std::vector<int>>> &boxes,
-                         std::vector<double> &times)
+                         std::vector<double> &times,
+                         const DBDetectorParams *params)
     {
+        if (params == nullptr)
+            params = &this->params_;
         float ratio_h{};
         float ratio_w{};
 
@@ -89,8 +92,8 @@ namespace PaddleOCR
         img.copyTo(srcimg);
 
         auto preprocess_start = std::chrono::steady_clock::now();
-        this->resize_op_.Run(img, resize_img, this->limit_type_,
-                             this->limit_side_len_, ratio_h, ratio_w,
+        this->resize_op_.Run(img, resize_img, params->limit_type,
+                             params->limit_side_len, ratio_h, ratio_w,
                              this->use_tensorrt_);
 
         this->normalize_op_.Run(&resize_img, this->mean_, this->scale_,
@@ -137,7 +140,7 @@ namespace PaddleOCR
         cv::Mat cbuf_map(n2, n3, CV_8UC1, (unsigned char *)cbuf.data());
         cv::Mat pred_map(n2, n3, CV_32F, (float *)pred.data());
 
-        const double threshold = this->det_db_thresh_ * 255;
+        const double threshold = params->det_db_thresh * 255;
         const double maxvalue = 255;
         cv::Mat bit_map;
         cv::threshold(cbuf_map, bit_map, threshold, maxvalue, cv::THRESH_BINARY);
@@ -149,8 +152,8 @@ namespace PaddleOCR
         }
 
         boxes = post_processor_.BoxesFromBitmap(
-            pred_map, bit_map, this->det_db_box_thresh_, this->det_db_unclip_ratio_,
-            this->det_db_score_mode_);
+            pred_map, bit_map, params->det_db_box_thresh, params->det_db_unclip_ratio,
+            params->det_db_score_mode);
 
         boxes = post_processor_.FilterTagDetRes(boxes, ratio_h, ratio_w, srcimg);
         auto postprocess_end = std::chrono::steady_clock::now();
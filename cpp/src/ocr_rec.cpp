@@ -17,11 +17,14 @@
 namespace PaddleOCR
 {
 
-    void CRNNRecognizer::Run(std::vector<cv::Mat> img_list,
+    bool CRNNRecognizer::Run(std::vector<cv::Mat> img_list,
                              std::vector<std::string> &rec_texts,
                              std::vector<float> &rec_text_scores,
-                             std::vector<double> &times)
+                             std::vector<double> &times,
+                             const std::function<bool()> &next_batch,
+                             const std::function<void(const std::vector<int> &)> &batch_done)
     {
+        bool completed = true;
         std::chrono::duration<float> preprocess_diff = std::chrono::duration<float>::zero();
         std::chrono::duration<float> inference_diff = std::chrono::duration<float>::zero();
         std::chrono::duration<float> postprocess_diff = std::chrono::duration<float>::zero();
@@ -37,6 +40,11 @@ namespace PaddleOCR
         for (int beg_img_no = 0; beg_img_no < img_num;
              beg_img_no += this->rec_batch_num_)
         {
+            if (next_batch && !next_batch())
+            { // Stopped, e.g. out of time. Leave the remaining lines unrecognized
+                completed = false;
+                break;
+            }
             auto preprocess_start = std::chrono::steady_clock::now();
             int end_img_no = std::min(img_num, beg_img_no + this->rec_batch_num_);
             int batch_num = end_img_no - beg_img_no;
@@ -130,10 +138,15 @@ namespace PaddleOCR
             }
             auto postprocess_end = std::chrono::steady_clock::now();
             postprocess_diff += postprocess_end - postprocess_start;
+            if (batch_done)
+            {
+                batch_done(std::vector<int>(indices.begin() + beg_img_no, indices.begin() + end_img_no));
+            }
         }
         times.push_back(double(preprocess_diff.count() * 1000));
         times.push_back(double(inference_diff.count() * 1000));
         times.push_back(double(postprocess_diff.count() * 1000));
+        return completed;
     }
 
     void CRNNRecognizer::LoadModel(const std::string &model_dir)
@@ -50,16 +50,45 @@ namespace PaddleOCR
         }
     }
 
+    PPOCR::PPOCR(const PPOCR &base) : PPOCR(base, true, true, true)
+    {
+    }
+
+    PPOCR::PPOCR(const PPOCR &base, bool det, bool cls, bool rec)
+    {
+        // Copy det/cls/rec settings, then replace the shared predictor with a clone of it.
+        // Predictor::Clone() reuses the loaded weights, so this is much cheaper than loading the models again.
+        if (det && base.detector_)
+        {
+            this->detector_.reset(new DBDetector(*base.detector_));
+            this->detector_->predictor_ = base.detector_->predictor_->Clone();
+        }
+        if (cls && base.classifier_)
+        {
+            this->classifier_.reset(new Classifier(*base.classifier_));
+            this->classifier_->predictor_ = base.classifier_->predictor_->Clone();
+        }
+        if (rec && base.recognizer_)
+        {
+            this->recognizer_.reset(new CRNNRecognizer(*base.recognizer_));
+            this->recognizer_->predictor_ = base.recognizer_->predictor_->Clone();
+        }
+    }
+
     std::vector<std::vector<OCRPredictResult>> // OCR a batch of Mat images
     PPOCR::ocr(std::vector<cv::Mat> img_list, bool det, bool rec, bool cls)
     {
         std::vector<std::vector<OCRPredictResult>> ocr_results;
+        this->timeout_ = false;
+        // Lines of a batch are not indexed by a single result, the line hook does not apply
+        std::function<void(const std::vector<OCRPredictResult> &, const std::vector<int> &)> line_hook;
+        line_hook.swap(this->line_hook_);
 
         if (!det)
         { // Process without det
             std::vector<OCRPredictResult> ocr_result;
             ocr_result.resize(img_list.size());
-            if (cls && this->classifier_)
+            if (cls && this->classifier_ && this->next_stage())
             {
                 this->cls(img_list, ocr_result);
                 for (int i = 0; i < img_list.size(); i++)
@@ -71,7 +100,7 @@ namespace PaddleOCR
                     }
                 }
             }
-            if (rec)
+            if (rec) // Stages of rec are its batches
             {
                 this->rec(img_list, ocr_result);
             }
@@ -83,14 +112,34 @@ namespace PaddleOCR
             }
         }
         else
-        { // Normal det+cls+rec process
+        { // Normal det+cls+rec process. Detect each image, then classify and recognize
+          // the text lines of all images together, so their batches span images
+            ocr_results.resize(img_list.size());
+            std::vector<cv::Mat> crop_list;
+            std::vector<OCRPredictResult> line_results;
             for (int i = 0; i < img_list.size(); ++i)
             {
-                std::vector<OCRPredictResult> ocr_result =
-                    this->ocr(img_list[i], true, rec, cls);
-                ocr_results.push_back(ocr_result);
+                if (!this->next_stage())
+                    break; // Images left undetected have no results
+                this->det(img_list[i], ocr_results[i]);
+                for (int j = 0; j < ocr_results[i].size(); j++)
+                {
+                    crop_list.push_back(Utility::GetRotateCropImage(img_list[i], ocr_results[i][j].box));
+                    line_results.push_back(ocr_results[i][j]);
+                }
+            }
+            this->cls_rec(crop_list, line_results, rec, cls);
+            // Hand the line results back to their images
+            int k = 0;
+            for (int i = 0; i < ocr_results.size(); ++i)
+            {
+                for (int j = 0; j < ocr_results[i].size(); j++)
+                {
+                    ocr_results[i][j] = line_results[k++];
+                }
             }
         }
+        this->line_hook_.swap(line_hook);
         return ocr_results;
     }
 
@@ -101,46 +150,104 @@ namespace PaddleOCR
 
         std::vector<OCRPredictResult> ocr_result;
         std::vector<cv::Mat> img_list;
+        this->timeout_ = false;
+        if (!this->next_stage())
+        { // Deadline passed before the image was reached
+            return ocr_result;
+        }
+        this->find_lines(img, det, ocr_result, img_list);
+        if (det && this->line_hook_ && !ocr_result.empty())
+        {
+            std::vector<int> lines(ocr_result.size());
+            for (int j = 0; j < lines.size(); j++)
+                lines[j] = j;
+            this->line_hook_(ocr_result, lines);
+        }
+        this->cls_rec(img_list, ocr_result, rec, cls);
+        return ocr_result;
+    }
+
+    void PPOCR::find_lines(cv::Mat img, bool det,
+                           std::vector<OCRPredictResult> &ocr_results,
+                           std::vector<cv::Mat> &img_list)
+    {
         // det
         if (det)
         {
-            this->det(img, ocr_result); // Get det result
+            this->det(img, ocr_results); // Get det result
+            if (this->full_loader_ && !ocr_results.empty())
+            { // Boxes were found on a reduced decode, crop the lines from the full resolution image
+                cv::Mat full = this->full_loader_();
+                if (!full.empty())
+                {
+                    double scale_x = static_cast<double>(full.cols) / img.cols;
+                    double scale_y = static_cast<double>(full.rows) / img.rows;
+                    for (OCRPredictResult &res : ocr_results)
+                    {
+                        for (std::vector<int> &point : res.box)
+                        {
+                            point[0] = std::min(static_cast<int>(point[0] * scale_x), full.cols - 1);
+                            point[1] = std::min(static_cast<int>(point[1] * scale_y), full.rows - 1);
+                        }
+                    }
+                    img = full;
+                }
+            }
             // Crop image according to det result
-            for (int j = 0; j < ocr_result.size(); j++)
+            for (int j = 0; j < ocr_results.size(); j++)
             {
                 cv::Mat crop_img;
-                crop_img = Utility::GetRotateCropImage(img, ocr_result[j].box);
+                crop_img = Utility::GetRotateCropImage(img, ocr_results[j].box);
                 img_list.push_back(crop_img);
             }
         }
+        else if (this->rois_ != nullptr)
+        {
+            // Each region is a line of its own
+            for (const cv::Rect &rect : *this->rois_)
+            {
+                cv::Rect roi = rect & cv::Rect(0, 0, img.cols, img.rows);
+                if (roi.empty())
+                    continue;
+                OCRPredictResult res;
+                res.box = {{roi.x, roi.y}, {roi.x + roi.width - 1, roi.y}, {roi.x + roi.width - 1, roi.y + roi.height - 1}, {roi.x, roi.y + roi.height - 1}};
+                ocr_results.push_back(res);
+                img_list.push_back(img(roi).clone()); // cls may rotate it in place
+            }
+        }
         else
         {
             // Create a box the size of the whole image
             std::vector<std::vector<int>> box = {{0, 0}, {img.cols - 1, 0}, {img.cols - 1, img.rows - 1}, {0, img.rows - 1}};
             OCRPredictResult res;
             res.box = box;
-            ocr_result.push_back(res);
+            ocr_results.push_back(res);
             img_list.push_back(img);
         }
+    }
+
+    void PPOCR::cls_rec(std::vector<cv::Mat> &img_list,
+                        std::vector<OCRPredictResult> &ocr_results,
+                        bool rec, bool cls)
+    {
         // cls
-        if (cls && this->classifier_)
+        if (cls && this->classifier_ && this->next_stage())
         {
-            this->cls(img_list, ocr_result);
+            this->cls(img_list, ocr_results);
             for (int i = 0; i < img_list.size(); i++)
             {
-                if (ocr_result[i].cls_label % 2 == 1 &&
-                    ocr_result[i].cls_score > this->classifier_->cls_thresh)
+                if (ocr_results[i].cls_label % 2 == 1 &&
+                    ocr_results[i].cls_score > this->classifier_->cls_thresh)
                 {
                     cv::rotate(img_list[i], img_list[i], 1);
                 }
             }
         }
         // rec
-        if (rec)
+        if (rec) // Stages of rec are its batches
         {
-            this->rec(img_list, ocr_result);
+            this->rec(img_list, ocr_results);
         }
-        return ocr_result;
     }
 
     void PPOCR::det(cv::Mat img, std::vector<OCRPredictResult> &ocr_results)
@@ -148,7 +255,36 @@ namespace PaddleOCR
         std::vector<std::vector<std::vector<int>>> boxes;
         std::vector<double> det_times;
 
-        this->detector_->Run(img, boxes, det_times);
+        if (this->rois_ == nullptr)
+        {
+            this->detector_->Run(img, boxes, det_times, this->det_params_);
+        }
+        else
+        { // Detect inside each region only, without shrinking it to the size limit of the whole image,
+          // then move the boxes to image coordinates
+            det_times = {0, 0, 0};
+            for (const cv::Rect &rect : *this->rois_)
+            {
+                cv::Rect roi = rect & cv::Rect(0, 0, img.cols, img.rows);
+                if (roi.empty())
+                    continue;
+                cv::Mat roi_img = img(roi);
+                std::vector<std::vector<std::vector<int>>> roi_boxes;
+                std::vector<double> roi_times;
+                this->detector_->Run(roi_img, roi_boxes, roi_times, this->det_params_);
+                for (auto &box : roi_boxes)
+                {
+                    for (auto &point : box)
+                    {
+                        point[0] += roi.x;
+                        point[1] += roi.y;
+                    }
+                    boxes.push_back(std::move(box));
+                }
+                for (int i = 0; i < 3; i++)
+                    det_times[i] += roi_times[i];
+            }
+        }
 
         for (int i = 0; i < boxes.size(); i++)
         {
@@ -169,7 +305,24 @@ namespace PaddleOCR
         std::vector<std::string> rec_texts(img_list.size(), "");
         std::vector<float> rec_text_scores(img_list.size(), 0);
         std::vector<double> rec_times;
-        this->recognizer_->Run(img_list, rec_texts, rec_text_scores, rec_times);
+        std::function<void(const std::vector<int> &)> batch_done;
+        if (this->line_hook_)
+        { // Hand each batch out as soon as it is recognized
+            batch_done = [&](const std::vector<int> &lines)
+            {
+                for (int i : lines)
+                {
+                    ocr_results[i].text = rec_texts[i];
+                    ocr_results[i].score = rec_text_scores[i];
+                }
+                this->line_hook_(ocr_results, lines);
+            };
+        }
+        if (!this->recognizer_->Run(img_list, rec_texts, rec_text_scores, rec_times, [this]
+                                    { return this->next_stage(); }, batch_done))
+        {
+            this->timeout_ = true; // Some lines were left unrecognized
+        }
         // output rec results
         for (int i = 0; i < rec_texts.size(); i++)
         {
@@ -199,6 +352,78 @@ namespace PaddleOCR
         this->time_info_cls[2] += cls_times[2];
     }
 
+    void PPOCR::set_deadline(std::chrono::steady_clock::time_point deadline)
+    {
+        this->deadline_ = deadline;
+    }
+
+    bool PPOCR::is_timeout() const
+    {
+        return this->timeout_;
+    }
+
+    void PPOCR::set_det_params(const DBDetectorParams *params)
+    {
+        this->det_params_ = params;
+    }
+
+    void PPOCR::set_rois(const std::vector<cv::Rect> *rois)
+    {
+        this->rois_ = rois;
+    }
+
+    void PPOCR::set_full_image(std::function<cv::Mat()> loader)
+    {
+        this->full_loader_ = std::move(loader);
+    }
+
+    void PPOCR::set_stage_hook(std::function<void()> hook)
+    {
+        this->stage_hook_ = std::move(hook);
+    }
+
+    void PPOCR::set_line_hook(std::function<void(const std::vector<OCRPredictResult> &, const std::vector<int> &)> hook)
+    {
+        this->line_hook_ = std::move(hook);
+    }
+
+    bool PPOCR::next_stage()
+    {
+        if (this->stage_hook_)
+        {
+            // The hook may run other ocr() calls on this engine. It is taken out meanwhile, so they do not call it again.
+            // Their lines are not part of this call either.
+            std::function<void()> hook;
+            hook.swap(this->stage_hook_);
+            std::function<void(const std::vector<OCRPredictResult> &, const std::vector<int> &)> line_hook;
+            line_hook.swap(this->line_hook_);
+            std::chrono::steady_clock::time_point deadline = this->deadline_;
+            bool timeout = this->timeout_;
+            const DBDetectorParams *det_params = this->det_params_;
+            const std::vector<cv::Rect> *rois = this->rois_;
+            std::function<cv::Mat()> full_loader;
+            full_loader.swap(this->full_loader_);
+            hook();
+            this->deadline_ = deadline;
+            this->timeout_ = timeout;
+            this->det_params_ = det_params;
+            this->rois_ = rois;
+            this->full_loader_.swap(full_loader);
+            this->line_hook_.swap(line_hook);
+            this->stage_hook_.swap(hook);
+        }
+        return !this->out_of_time();
+    }
+
+    bool PPOCR::out_of_time()
+    {
+        if (!this->timeout_ && std::chrono::steady_clock::now() >= this->deadline_)
+        {
+            this->timeout_ = true;
+        }
+        return this->timeout_;
+    }
+
     void PPOCR::reset_timer()
     {
         this->time_info_det = {0, 0, 0};
@@ -0,0 +1,93 @@
+// PaddleOCR-json
+// https://github.com/hiroi-sora/PaddleOCR-json
+
+#include "include/result_cache.h"
+
+namespace PaddleOCR
+{
+    ResultCache::ResultCache(size_t max_bytes) : max_bytes_(max_bytes) {}
+
+    bool ResultCache::enabled() const
+    {
+        return max_bytes_ > 0;
+    }
+
+    size_t ResultCache::bytes() const
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return bytes_;
+    }
+
+    size_t ResultCache::entry_size(const std::string &key, const std::string &result)
+    {
+        return key.size() * 2 + result.size() + 64; // The key is stored in the map and the LRU list, plus node overhead
+    }
+
+    bool ResultCache::acquire(const std::string &key, std::string &result, bool &owner,
+                              std::chrono::steady_clock::time_point deadline)
+    {
+        owner = false;
+        if (!enabled())
+            return false;
+        std::unique_lock<std::mutex> lock(mutex_);
+        while (true)
+        {
+            auto it = entries_.find(key);
+            if (it != entries_.end())
+            { // Hit, mark as most recently used
+                lru_.splice(lru_.begin(), lru_, it->second.lru);
+                result = it->second.result;
+                return true;
+            }
+            auto computing = computing_.find(key);
+            if (computing == computing_.end())
+            { // Nobody computes it yet, the caller does
+                computing_[key] = std::this_thread::get_id();
+                owner = true;
+                return false;
+            }
+            for (auto &c : computing_)
+            {
+                if (c.second == std::this_thread::get_id())
+                { // This request runs between the stages of another one that this thread computes.
+                  // Waiting could deadlock, compute it without caching instead.
+                    return false;
+                }
+            }
+            if (deadline == std::chrono::steady_clock::time_point::max())
+                cond_.wait(lock);
+            else if (cond_.wait_until(lock, deadline) == std::cv_status::timeout)
+                return false; // The owner took too long for this request
+        }
+    }
+
+    void ResultCache::finish(const std::string &key, const std::string *result)
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            computing_.erase(key);
+            if (result != nullptr && entry_size(key, *result) <= max_bytes_ && entries_.find(key) == entries_.end())
+            {
+                lru_.push_front(key);
+                Entry &entry = entries_[key];
+                entry.result = *result;
+                entry.lru = lru_.begin();
+                bytes_ += entry_size(key, *result);
+                evict();
+            }
+        }
+        cond_.notify_all(); // Waiters find the result, or one of them computes it when it was not cacheable
+    }
+
+    void ResultCache::evict()
+    {
+        while (bytes_ > max_bytes_ && !lru_.empty())
+        {
+            auto it = entries_.find(lru_.back());
+            bytes_ -= entry_size(it->first, it->second.result);
+            entries_.erase(it);
+            lru_.pop_back();
+        }
+    }
+
+} // namespace PaddleOCR
@@ -0,0 +1,82 @@
+#include <algorithm>
+
+#include "include/paddleocr.h"
+#include "include/task.h"
+#include "include/stage_pipeline.h"
+
+namespace PaddleOCR
+{
+    StagePipeline::StagePipeline(const Task &base, int threads_per_stage, int queue_size, bool det, bool rec, bool cls)
+        : det_(det), rec_(rec), cls_(cls && base.ppocr->classifier_)
+    {
+        if (threads_per_stage < 1)
+            threads_per_stage = 1;
+        std::vector<StageRunner<Task, Item>::Stage> stages(cls_ ? 3 : 2); // Without cls, det hands its lines straight to rec
+        StageRunner<Task, Item>::Stage &det_stage = stages.front(), &rec_stage = stages.back();
+        for (int i = 0; i < threads_per_stage; i++)
+        {
+            det_stage.workers.push_back(&stage_task(base, true, false, false));
+            if (cls_)
+                stages[1].workers.push_back(&stage_task(base, false, true, false));
+            rec_stage.workers.push_back(&stage_task(base, false, false, true));
+        }
+        det_stage.name = "det";
+        det_stage.work = [this](Task &task, Item &item)
+        {
+            task.ppocr->set_full_image(item.full_loader); // Set for every image, so none inherits another's
+            task.ppocr->find_lines(item.img, det_, item.lines, item.crops);
+            task.ppocr->set_full_image();
+            item.full_loader = nullptr;
+            item.img.release(); // Only the crops go on
+            task.memory_check_cleanup();
+        };
+        if (cls_)
+        {
+            stages[1].name = "cls";
+            stages[1].work = [](Task &task, Item &item)
+            {
+                task.ppocr->cls_rec(item.crops, item.lines, false, true);
+                task.memory_check_cleanup();
+            };
+        }
+        rec_stage.name = "rec";
+        rec_stage.work = [this](Task &task, Item &item)
+        {
+            task.ppocr->cls_rec(item.crops, item.lines, rec_, false);
+            task.memory_check_cleanup();
+        };
+        auto finish = [](Task &task, Item &item, const std::string &error)
+        {
+            item.img.release();
+            item.full_loader = nullptr;
+            item.crops.clear();
+            if (!error.empty()) // Lines of a failed image are incomplete
+                item.lines.clear();
+            item.done(task, item.lines, error);
+        };
+        runner_.reset(new StageRunner<Task, Item>(std::move(stages), static_cast<size_t>(std::max(queue_size, 1)), finish));
+    }
+
+    StagePipeline::~StagePipeline()
+    {
+        runner_.reset(); // Every queued image reaches done before the stage tasks go
+    }
+
+    Task &StagePipeline::stage_task(const Task &base, bool det, bool cls, bool rec)
+    {
+        std::unique_ptr<Task> task(new Task());
+        task->clone_engine(base, det, cls, rec);
+        tasks_.push_back(std::move(task));
+        return *tasks_.back();
+    }
+
+    void StagePipeline::submit(cv::Mat img, std::function<cv::Mat()> full_loader, Done done)
+    {
+        std::unique_ptr<Item> item(new Item());
+        item->img = img;
+        item->full_loader = std::move(full_loader);
+        item->done = std::move(done);
+        runner_->submit(std::move(item));
+    }
+
+} // namespace PaddleOCR
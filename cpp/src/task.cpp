@@ -1,15 +1,34 @@
 
+#include <algorithm>
+#include <cmath>
+#include <condition_variable>
+#include <cstdio>
+#include <cstring>
 #include <exception>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <mutex>
 #include <regex>
+#include <thread>
 
 #include "include/paddleocr.h"
 #include "include/args.h"
 #include "include/task.h"
-#include "include/base64.h" // base64 library
+#include "include/task_pool.h"
+#include "include/stage_pipeline.h"
+#include "include/batch_io.h"
+#include "include/result_cache.h"
+#include "include/json_writer.h" // Result serializer
+#include "include/image_size.h"  // Reduced decode of huge JPEG images, raw image size
+#include "include/base64_fast.h" // base64 decoding into buffer
+#include "xxhash.h"                // Image hash of the result cache
 
 // htonl function
 #if defined(_WIN32)
 #include <windows.h>
+#include <io.h>    // _setmode
+#include <fcntl.h> // _O_BINARY
 #else // Linux, Mac
 #include <arpa/inet.h>
 #endif
@@ -36,6 +55,171 @@ namespace PaddleOCR
         }
     }
 
+    // One member of a json object: unescaped key and the raw text of its value inside the request
+    struct JsonMember
+    {
+        std::string key;
+        const char *begin;   // Value text
+        const char *end;
+        bool escaped = false; // String value contains escape sequences
+    };
+
+    // Skip json whitespace
+    static const char *json_skip_ws(const char *p, const char *end)
+    {
+        while (p < end && (*p == ' ' || *p == '\t' || *p == '\n' || *p == '\r'))
+            p++;
+        return p;
+    }
+
+    // Scan the json string starting at the opening quote p. Return pointer after the closing quote, nullptr when unterminated.
+    // Set escaped when the string contains escape sequences.
+    static const char *json_scan_string(const char *p, const char *end, bool &escaped)
+    {
+        const char *start = ++p;
+        while (p < end)
+        {
+            const char *quote = static_cast<const char *>(memchr(p, '"', end - p));
+            if (quote == nullptr)
+                return nullptr;
+            // The quote is escaped when preceded by an odd number of backslashes
+            const char *b = quote;
+            while (b > start && b[-1] == '\\')
+                b--;
+            if ((quote - b) % 2 == 0)
+            {
+                escaped = memchr(start, '\\', quote - start) != nullptr;
+                return quote + 1;
+            }
+            p = quote + 1;
+        }
+        return nullptr;
+    }
+
+    // Scan the json value starting at p. Containers are skipped by bracket depth, scalars up to the next delimiter.
+    // Return pointer after the value, nullptr when malformed. The value itself is validated by whoever parses it.
+    static const char *json_scan_value(const char *p, const char *end, bool &escaped)
+    {
+        if (p >= end)
+            return nullptr;
+        if (*p == '"')
+            return json_scan_string(p, end, escaped);
+        const char *start = p;
+        if (*p == '{' || *p == '[')
+        {
+            int depth = 0;
+            while (p < end)
+            {
+                char c = *p;
+                if (c == '"')
+                {
+                    bool inner;
+                    p = json_scan_string(p, end, inner);
+                    if (p == nullptr)
+                        return nullptr;
+                    continue;
+                }
+                if (c == '{' || c == '[')
+                    depth++;
+                else if ((c == '}' || c == ']') && --depth == 0)
+                    return p + 1;
+                p++;
+            }
+            return nullptr;
+        }
+        while (p < end && *p != ',' && *p != '}' && *p != ']' && *p != ' ' && *p != '\t' && *p != '\n' && *p != '\r')
+            p++;
+        return p == start ? nullptr : p;
+    }
+
+    // Split the top-level json object in [p, end) into members without copying their values.
+    // Return false when it is not a well-formed object.
+    static bool json_split_object(const char *p, const char *end, std::vector<JsonMember> &members)
+    {
+        p = json_skip_ws(p, end);
+        if (p >= end || *p != '{')
+            return false;
+        p = json_skip_ws(p + 1, end);
+        if (p < end && *p == '}')
+            return json_skip_ws(p + 1, end) == end;
+        while (true)
+        {
+            // Key
+            if (p >= end || *p != '"')
+                return false;
+            bool escaped = false;
+            const char *key_end = json_scan_string(p, end, escaped);
+            if (key_end == nullptr)
+                return false;
+            JsonMember member;
+            member.key = escaped ? nlohmann::json::parse(p, key_end).get<std::string>() : std::string(p + 1, key_end - 1);
+            p = json_skip_ws(key_end, end);
+            if (p >= end || *p != ':')
+                return false;
+            // Value
+            member.begin = json_skip_ws(p + 1, end);
+            member.end = json_scan_value(member.begin, end, member.escaped);
+            if (member.end == nullptr)
+                return false;
+            p = json_skip_ws(member.end, end);
+            members.push_back(std::move(member));
+            // Next member or end of object
+            if (p < end && *p == ',')
+            {
+                p = json_skip_ws(p + 1, end);
+                continue;
+            }
+            if (p < end && *p == '}')
+                return json_skip_ws(p + 1, end) == end;
+            return false;
+        }
+    }
+
+    // Split the json array in [p, end) into the text of its elements. Return false when it is not a well-formed array.
+    static bool json_split_array(const char *p, const char *end, std::vector<std::pair<const char *, const char *>> &elements)
+    {
+        p = json_skip_ws(p, end);
+        if (p >= end || *p != '[')
+            return false;
+        p = json_skip_ws(p + 1, end);
+        if (p < end && *p == ']')
+            return json_skip_ws(p + 1, end) == end;
+        while (true)
+        {
+            bool escaped;
+            const char *element_end = json_scan_value(p, end, escaped);
+            if (element_end == nullptr)
+                return false;
+            elements.emplace_back(p, element_end);
+            p = json_skip_ws(element_end, end);
+            if (p < end && *p == ',')
+            {
+                p = json_skip_ws(p + 1, end);
+                continue;
+            }
+            if (p < end && *p == ']')
+                return json_skip_ws(p + 1, end) == end;
+            return false;
+        }
+    }
+
+    // Get the text of a json string member. Points into the request, unless the string has escapes that must be
+    // resolved into storage. Throw if the member is not a string.
+    static void json_string_text(const JsonMember &member, std::string &storage, const char *&text, size_t &length)
+    {
+        if (member.escaped)
+        {
+            storage = nlohmann::json::parse(member.begin, member.end).get<std::string>();
+            text = storage.data();
+            length = storage.length();
+            return;
+        }
+        if (*member.begin != '"')
+            throw std::invalid_argument("Json value is not a string.");
+        text = member.begin + 1;
+        length = member.end - member.begin - 2;
+    }
+
     // Set state
     void Task::set_state(int code, std::string msg)
     {
@@ -57,73 +241,465 @@ namespace PaddleOCR
         return json_dump(j);
     }
 
-    // Convert OCR result to json string
-    std::string Task::get_ocr_result_json(const std::vector<OCRPredictResult> &ocr_result)
+    // Append a member to a response json string without parsing it again.
+    // A binary response of the current round gets the member encoded in its format.
+    std::string Task::add_response_field(std::string str_out, const char *key, const std::string &value_json)
     {
-        nlohmann::json outJ;
-        outJ["code"] = 100;
-        outJ["data"] = nlohmann::json::array();
-        bool isEmpty = true;
-        for (int i = 0; i < ocr_result.size(); i++)
+        if (bin_is_response(str_out))
         {
-            nlohmann::json j;
-            j["text"] = ocr_result[i].text;
-            j["score"] = ocr_result[i].score;
-            std::vector<std::vector<int>> b = ocr_result[i].box;
-            // No bounding box
-            if (b.empty())
+            bool cbor = t_format == FORMAT_CBOR;
+            nlohmann::json value = nlohmann::json::parse(value_json);
+            std::vector<uint8_t> bytes = cbor ? nlohmann::json::to_cbor(value) : nlohmann::json::to_msgpack(value);
+            bin_grow_response(str_out);
+            bin_append_string(str_out, cbor, key);
+            str_out.append(bytes.begin(), bytes.end());
+            return str_out;
+        }
+        size_t end = str_out.rfind('}');
+        if (end == std::string::npos)
+            return str_out;
+        str_out.insert(end, std::string(",\"") + key + "\":" + value_json);
+        return str_out;
+    }
+
+    // Encode a response in the format the current round asked for. Results are written in that format already;
+    // only the small json responses (states, errors) are converted here. Binary responses may contain any byte,
+    // so they need a transport that frames each response; on line based transports the request gets an error.
+    std::string Task::encode_response(std::string str_out, bool framed)
+    {
+        if (t_format == FORMAT_JSON)
+            return str_out;
+        if (!framed)
+        {
+            ResultFormat format = t_format;
+            t_format = FORMAT_JSON; // The error goes out as json
+            str_out = get_state_json(CODE_ERR_FORMAT_UNFRAMED, MSG_ERR_FORMAT_UNFRAMED(format == FORMAT_MSGPACK ? "msgpack" : "cbor"));
+            if (!t_id.empty())
+                str_out = add_response_field(std::move(str_out), "id", t_id);
+            return str_out;
+        }
+        if (bin_is_response(str_out))
+            return str_out;
+        nlohmann::json j;
+        try
+        {
+            j = nlohmann::json::parse(str_out);
+        }
+        catch (...)
+        {
+            return str_out;
+        }
+        std::vector<uint8_t> bytes = t_format == FORMAT_MSGPACK ? nlohmann::json::to_msgpack(j) : nlohmann::json::to_cbor(j);
+        return std::string(bytes.begin(), bytes.end());
+    }
+
+    const char *Task::format_content_type(ResultFormat format)
+    {
+        switch (format)
+        {
+        case FORMAT_MSGPACK:
+            return "application/msgpack";
+        case FORMAT_CBOR:
+            return "application/cbor";
+        default:
+            return "application/json";
+        }
+    }
+
+    // Append the json of an OCR result to out: {"code":code,"data":[...]} with the members in the order nlohmann dumps them.
+    // A timeout result also carries its message in "msg".
+    // Return the number of text lines written.
+    size_t Task::write_ocr_result(std::string &out, const std::vector<OCRPredictResult> &ocr_result, int code)
+    {
+        out += "{\"code\":";
+        json_append_int(out, code);
+        out += ",\"data\":[";
+        size_t count = 0;
+        for (const OCRPredictResult &res : ocr_result)
+        {
+            if (!is_output_line(res))
+                continue;
+            if (count++ > 0)
+                out += ',';
+            write_ocr_line(out, res, -1, true);
+        }
+        out += ']';
+        if (code == CODE_ERR_TIMEOUT)
+        {
+            out += ",\"msg\":";
+            json_append_string(out, MSG_ERR_TIMEOUT, true);
+        }
+        out += '}';
+        return count;
+    }
+
+    // Whether a line goes into the result
+    bool Task::is_output_line(const OCRPredictResult &res)
+    {
+        // No bounding box: if det is enabled but still no bounding box, skip this group.
+        // If det is not enabled, it gets an empty bounding box
+        if (res.box.empty() && t_params.det)
+            return false;
+        // If rec is enabled but still no text, skip this group
+        return !(t_params.rec && (res.score <= 0 || res.text.empty()));
+    }
+
+    // Append the json of one text line. index >= 0 adds its position in the result, text = false leaves out the
+    // recognition (score, text) for lines that were only detected so far.
+    void Task::write_ocr_line(std::string &out, const OCRPredictResult &res, int index, bool text)
+    {
+        out += "{\"box\":[";
+        for (int bi = 0; bi < 4; bi++)
+        {
+            out += bi == 0 ? "[" : ",[";
+            if (res.box.empty())
             {
-                if (FLAGS_det) // If det is enabled but still no bounding box, skip this group
-                    continue;
-                else // If det is not enabled, fill with empty bounding box
-                    for (int bi = 0; bi < 4; bi++)
-                        b.push_back(std::vector<int>{-1, -1});
+                out += "-1,-1";
             }
-            // If rec is enabled but still no text, skip this group
-            if (FLAGS_rec && (j["score"] <= 0 || j["text"] == ""))
+            else
             {
-                continue;
+                json_append_int(out, res.box[bi][0]);
+                out += ',';
+                json_append_int(out, res.box[bi][1]);
+            }
+            out += ']';
+        }
+        out += ']';
+        // If cls is enabled, cls_label has actual value, then write direction classification related parameters
+        if (res.cls_label != -1)
+        {
+            out += ",\"cls_label\":"; // Direction label, 0 means clockwise 0° or 90°, 1 means 180° or 270°
+            json_append_int(out, res.cls_label);
+            out += ",\"cls_score\":"; // Direction label confidence, closer to 1 is more reliable
+            json_append_float(out, res.cls_score);
+        }
+        if (index >= 0)
+        {
+            out += ",\"index\":";
+            json_append_int(out, index);
+        }
+        if (text)
+        {
+            out += ",\"score\":";
+            json_append_float(out, res.score);
+            out += ",\"text\":";
+            json_append_string(out, res.text, FLAGS_ensure_ascii);
+        }
+        out += '}';
+    }
+
+    // Binary counterpart of write_ocr_result, in the format of the current round. Each box is one flat array
+    // [x0,y0,...,x3,y3]. The result map starts with a response header, so members can be appended to it.
+    size_t Task::write_ocr_result_bin(std::string &out, const std::vector<OCRPredictResult> &ocr_result, int code)
+    {
+        bool cbor = t_format == FORMAT_CBOR;
+        size_t count = 0;
+        for (const OCRPredictResult &res : ocr_result)
+            count += is_output_line(res);
+        bin_begin_response(out, cbor, code == CODE_ERR_TIMEOUT ? 3 : 2);
+        bin_append_string(out, cbor, "code");
+        bin_append_int(out, cbor, code);
+        bin_append_string(out, cbor, "data");
+        bin_append_array(out, cbor, count);
+        for (const OCRPredictResult &res : ocr_result)
+        {
+            if (is_output_line(res))
+                write_ocr_line_bin(out, res, -1, true);
+        }
+        if (code == CODE_ERR_TIMEOUT)
+        {
+            bin_append_string(out, cbor, "msg");
+            bin_append_string(out, cbor, MSG_ERR_TIMEOUT);
+        }
+        return count;
+    }
+
+    // Binary counterpart of write_ocr_line, members in the same order
+    void Task::write_ocr_line_bin(std::string &out, const OCRPredictResult &res, int index, bool text)
+    {
+        bool cbor = t_format == FORMAT_CBOR;
+        bool cls = res.cls_label != -1;
+        bin_append_map(out, cbor, 1 + (cls ? 2 : 0) + (index >= 0 ? 1 : 0) + (text ? 2 : 0));
+        bin_append_string(out, cbor, "box");
+        bin_append_array(out, cbor, 8);
+        for (int bi = 0; bi < 4; bi++)
+        {
+            bin_append_int(out, cbor, res.box.empty() ? -1 : res.box[bi][0]);
+            bin_append_int(out, cbor, res.box.empty() ? -1 : res.box[bi][1]);
+        }
+        if (cls)
+        {
+            bin_append_string(out, cbor, "cls_label");
+            bin_append_int(out, cbor, res.cls_label);
+            bin_append_string(out, cbor, "cls_score");
+            bin_append_float(out, cbor, res.cls_score);
+        }
+        if (index >= 0)
+        {
+            bin_append_string(out, cbor, "index");
+            bin_append_int(out, cbor, index);
+        }
+        if (text)
+        {
+            bin_append_string(out, cbor, "score");
+            bin_append_float(out, cbor, res.score);
+            bin_append_string(out, cbor, "text");
+            bin_append_string(out, cbor, res.text);
+        }
+    }
+
+    // Binary counterpart of get_state_json, as a plain map
+    void Task::write_state_bin(std::string &out, int code, const std::string &msg)
+    {
+        bool cbor = t_format == FORMAT_CBOR;
+        size_t begin = out.size();
+        try
+        {
+            bin_append_map(out, cbor, 2);
+            bin_append_string(out, cbor, "code");
+            bin_append_int(out, cbor, code);
+            bin_append_string(out, cbor, "data");
+            bin_append_string(out, cbor, msg);
+        }
+        catch (...)
+        { // Message is not valid UTF-8
+            out.resize(begin);
+            bin_append_map(out, cbor, 2);
+            bin_append_string(out, cbor, "code");
+            bin_append_int(out, cbor, CODE_ERR_JSON_DUMP);
+            bin_append_string(out, cbor, "data");
+            bin_append_string(out, cbor, MSG_ERR_JSON_DUMP);
+        }
+    }
+
+    // Send lines of a streaming request as a record of their own, before the final response:
+    // the boxes after det ("stage": "det"), then the text of each rec batch ("stage": "rec")
+    void Task::stream_lines(const std::vector<OCRPredictResult> &ocr_result, const std::vector<int> &lines, bool detected)
+    {
+        std::vector<int> picked;
+        for (int i : lines)
+        {
+            if (detected || is_output_line(ocr_result[i]))
+                picked.push_back(i);
+        }
+        if (picked.empty())
+            return;
+        std::string record;
+        try
+        {
+            if (t_format == FORMAT_JSON)
+            {
+                record = "{\"code\":";
+                json_append_int(record, CODE_OK_PARTIAL);
+                record += ",\"data\":[";
+                for (size_t k = 0; k < picked.size(); k++)
+                {
+                    if (k > 0)
+                        record += ',';
+                    write_ocr_line(record, ocr_result[picked[k]], picked[k], !detected);
+                }
+                record += detected ? "],\"stage\":\"det\"}" : "],\"stage\":\"rec\"}";
             }
             else
             {
-                j["box"] = {{b[0][0], b[0][1]}, {b[1][0], b[1][1]}, {b[2][0], b[2][1]}, {b[3][0], b[3][1]}};
+                bool cbor = t_format == FORMAT_CBOR;
+                bin_begin_response(record, cbor, 3);
+                bin_append_string(record, cbor, "code");
+                bin_append_int(record, cbor, CODE_OK_PARTIAL);
+                bin_append_string(record, cbor, "data");
+                bin_append_array(record, cbor, picked.size());
+                for (int i : picked)
+                    write_ocr_line_bin(record, ocr_result[i], i, !detected);
+                bin_append_string(record, cbor, "stage");
+                bin_append_string(record, cbor, detected ? "det" : "rec");
             }
-            // If cls is enabled, cls_label has actual value, then write direction classification related parameters
-            if (ocr_result[i].cls_label != -1)
+        }
+        catch (...)
+        { // Text is not valid UTF-8, the final response reports it
+            return;
+        }
+        if (!t_id.empty())
+            record = add_response_field(std::move(record), "id", t_id);
+        t_stream_sink(std::move(record));
+    }
+
+    // Convert OCR result to json string, empty when no text found.
+    // The result of a call that ran out of time is a timeout response holding the partial text.
+    std::string Task::get_ocr_result_json(const std::vector<OCRPredictResult> &ocr_result, bool timeout)
+    {
+        t_json.clear();
+        try
+        {
+            size_t count = write_ocr_result(t_json, ocr_result, timeout ? CODE_ERR_TIMEOUT : CODE_OK);
+            // Result 1: Recognition successful, no text (rec not detected)
+            if (count == 0 && !timeout)
+                return "";
+        }
+        catch (...)
+        { // Text is not valid UTF-8
+            return get_state_json(CODE_ERR_JSON_DUMP, MSG_ERR_JSON_DUMP);
+        }
+        // Result 2: Recognition successful, with text
+        return t_json;
+    }
+
+    // Like get_ocr_result_json, in the binary format of the current round
+    std::string Task::get_ocr_result_bin(const std::vector<OCRPredictResult> &ocr_result, bool timeout)
+    {
+        t_json.clear();
+        try
+        {
+            size_t count = write_ocr_result_bin(t_json, ocr_result, timeout ? CODE_ERR_TIMEOUT : CODE_OK);
+            if (count == 0 && !timeout)
+                return "";
+        }
+        catch (...)
+        { // Text is not valid UTF-8
+            return get_state_json(CODE_ERR_JSON_DUMP, MSG_ERR_JSON_DUMP);
+        }
+        return t_json;
+    }
+
+    OCRParams Task::default_params()
+    {
+        OCRParams params;
+        params.det = FLAGS_det;
+        params.rec = FLAGS_rec;
+        params.cls = FLAGS_cls;
+        params.det_params.limit_type = FLAGS_limit_type;
+        params.det_params.limit_side_len = FLAGS_limit_side_len;
+        params.det_params.det_db_thresh = FLAGS_det_db_thresh;
+        params.det_params.det_db_box_thresh = FLAGS_det_db_box_thresh;
+        params.det_params.det_db_unclip_ratio = FLAGS_det_db_unclip_ratio;
+        params.det_params.det_db_score_mode = FLAGS_det_db_score_mode;
+        return params;
+    }
+
+    // Override an OCR parameter for the current request. Throw if the value has the wrong type or is out of range.
+    // Models cannot be loaded per request, so det and rec may only be enabled if they were at startup (checked in run_image).
+    bool Task::read_param(const std::string &key, const nlohmann::json &value)
+    {
+        DBDetectorParams &det = t_params.det_params;
+        if (key == "det" || key == "rec" || key == "cls")
+        {
+            bool enable = value.get<bool>();
+            (key == "det" ? t_params.det : key == "rec" ? t_params.rec : t_params.cls) = enable;
+            return true;
+        }
+        if (key == "rois")
+        { // Regions of interest, [[x, y, width, height], ...] in image pixels
+            if (!value.is_array())
+                throw std::invalid_argument("rois must be an array.");
+            t_params.rois.clear();
+            for (auto &roi : value)
             {
-                j["cls_label"] = ocr_result[i].cls_label; // Direction label, 0 means clockwise 0° or 90°, 1 means 180° or 270°
-                j["cls_score"] = ocr_result[i].cls_score; // Direction label confidence, closer to 1 is more reliable
+                if (!roi.is_array() || roi.size() != 4)
+                    throw std::invalid_argument("Each roi must be [x, y, width, height].");
+                for (auto &v : roi)
+                {
+                    if (!v.is_number_integer() || v.get<int64_t>() < 0 || v.get<int64_t>() > (1 << 24))
+                        throw std::invalid_argument("roi values must be non-negative integers.");
+                }
+                cv::Rect rect(roi[0].get<int>(), roi[1].get<int>(), roi[2].get<int>(), roi[3].get<int>());
+                if (rect.width <= 0 || rect.height <= 0)
+                    throw std::invalid_argument("roi width and height must be positive.");
+                t_params.rois.push_back(rect);
             }
+            return true;
+        }
+        if (key == "limit_side_len")
+        {
+            if (!value.is_number_integer() || value.get<int>() <= 0)
+                throw std::invalid_argument("limit_side_len must be a positive integer.");
+            det.limit_side_len = value.get<int>();
+        }
+        else if (key == "det_db_thresh" || key == "det_db_box_thresh")
+        {
+            if (!value.is_number() || value.get<double>() < 0 || value.get<double>() > 1)
+                throw std::invalid_argument("Threshold must be between 0 and 1.");
+            (key == "det_db_thresh" ? det.det_db_thresh : det.det_db_box_thresh) = value.get<double>();
+        }
+        else if (key == "det_db_unclip_ratio")
+        {
+            if (!value.is_number() || value.get<double>() <= 0)
+                throw std::invalid_argument("det_db_unclip_ratio must be positive.");
+            det.det_db_unclip_ratio = value.get<double>();
+        }
+        else if (key == "det_db_score_mode")
+        {
+            std::string mode = value.get<std::string>();
+            if (mode != "slow" && mode != "fast")
+                throw std::invalid_argument("det_db_score_mode must be slow or fast.");
+            det.det_db_score_mode = mode;
+        }
+        else
+        {
+            return false;
+        }
+        t_params.det_override = true;
+        return true;
+    }
 
-            outJ["data"].push_back(j);
-            isEmpty = false;
+    // Check whether a request asked for the bulk lane. Only splits the json, so the server can pick the lane
+    // before a worker decodes the request. Malformed requests count as interactive and fail on the worker.
+    bool Task::is_bulk_request(const std::string &str_in)
+    {
+        size_t json_end = std::min(str_in.find('\0'), str_in.length());
+        std::vector<JsonMember> members;
+        try
+        {
+            if (!json_split_object(str_in.data(), str_in.data() + json_end, members))
+                return false;
+            for (auto &member : members)
+            {
+                if (member.key == "priority")
+                    return nlohmann::json::parse(member.begin, member.end) == "bulk";
+            }
         }
-        // Result 1: Recognition successful, no text (rec not detected)
-        if (isEmpty)
+        catch (...)
         {
-            return "";
         }
-        // Result 2: Recognition successful, with text
-        return json_dump(outJ);
+        return false;
     }
 
-    // Input base64 encoded string, return Mat
-    cv::Mat Task::imread_base64(std::string &b64str, int flag)
+    // Check whether a request asks to keep the socket connection open, without decoding its image
+    bool Task::is_keep_alive_request(const std::string &str_in)
     {
-        std::string decoded_string;
+        size_t json_end = std::min(str_in.find('\0'), str_in.length());
+        std::vector<JsonMember> members;
         try
         {
-            decoded_string = base64_decode(b64str);
+            if (!json_split_object(str_in.data(), str_in.data() + json_end, members))
+                return false;
+            for (auto &member : members)
+            {
+                if (member.key == "keep_alive")
+                {
+                    nlohmann::json value = nlohmann::json::parse(member.begin, member.end);
+                    return value.is_boolean() ? value.get<bool>() : (value == 1 || value == "1");
+                }
+            }
         }
         catch (...)
+        {
+        }
+        return false;
+    }
+
+    // Input base64 encoded string, return Mat.
+    // The string is decoded straight into the buffer handed to cv::imdecode().
+    cv::Mat Task::imread_base64(const char *b64, size_t length, int flag, bool reduce)
+    {
+        size_t decoded_length = base64_decoded_length(b64, length);
+        std::shared_ptr<uchar> decoded(new uchar[decoded_length > 0 ? decoded_length : 1], std::default_delete<uchar[]>());
+        if (!base64_decode_into(b64, length, decoded.get()))
         {
             set_state(CODE_ERR_BASE64_DECODE, MSG_ERR_BASE64_DECODE); // Report status: parsing failed
             return cv::Mat();
         }
         try
         {
-            std::vector<uchar> data(decoded_string.begin(), decoded_string.end());
-            cv::Mat img = cv::imdecode(data, flag);
+            cv::Mat img = imdecode_reducible(reinterpret_cast<const char *>(decoded.get()), decoded_length, flag, reduce, decoded);
             if (img.empty())
             {
                 set_state(CODE_ERR_BASE64_IM_DECODE, MSG_ERR_BASE64_IM_DECODE); // Report status: convert to Mat failed
@@ -137,7 +713,102 @@ namespace PaddleOCR
         }
     }
 
-    // Input json string, parse and read Mat
+    // Decode image file data. With reduce, a JPEG far larger than detection needs (see reduced_decode_mp) is decoded
+    // at 1/2, 1/4 or 1/8 of its size, which skips most of the decoding work and memory. t_full_loader then decodes
+    // the full resolution image from data again, for cropping the lines; owner keeps data alive until then.
+    cv::Mat Task::imdecode_reducible(const char *data, size_t length, int flag, bool reduce, std::shared_ptr<const void> owner)
+    {
+        int width, height;
+        if (reduce && flag == cv::IMREAD_COLOR && FLAGS_reduced_decode_mp > 0 &&
+            jpeg_size(reinterpret_cast<const unsigned char *>(data), length, width, height))
+        {
+            int scale = reduced_decode_scale(width, height, FLAGS_limit_type, FLAGS_limit_side_len, FLAGS_reduced_decode_mp);
+            if (scale > 1)
+            {
+                int mode = scale == 8 ? cv::IMREAD_REDUCED_COLOR_8 : (scale == 4 ? cv::IMREAD_REDUCED_COLOR_4 : cv::IMREAD_REDUCED_COLOR_2);
+                cv::Mat img = cv::imdecode(cv::_InputArray(data, static_cast<int>(length)), mode);
+                if (!img.empty())
+                {
+                    t_full_loader = [owner, data, length]()
+                    {
+                        try
+                        {
+                            return cv::imdecode(cv::_InputArray(data, static_cast<int>(length)), cv::IMREAD_COLOR);
+                        }
+                        catch (...)
+                        {
+                            return cv::Mat();
+                        }
+                    };
+                    return img;
+                }
+            }
+        }
+        return cv::imdecode(cv::_InputArray(data, static_cast<int>(length)), flag);
+    }
+
+    // Input raw pixel description and pixel data, return Mat.
+    // desc holds width, height, channels (1 gray, 3 BGR, 4 BGRA, default 3) and stride in bytes (default width * channels).
+    // BGR pixels are wrapped without copying, so data must outlive the returned Mat.
+    cv::Mat Task::imread_raw(const nlohmann::json &desc, char *data, size_t length)
+    {
+        int width, height, channels;
+        size_t stride;
+        try
+        {
+            width = desc.at("width").get<int>();
+            height = desc.at("height").get<int>();
+            channels = desc.value("channels", 3);
+            stride = desc.value("stride", static_cast<size_t>(width) * channels);
+        }
+        catch (...)
+        {
+            set_state(CODE_ERR_RAW_PARAM, MSG_ERR_RAW_PARAM); // Report status: parameters missing or wrong type
+            return cv::Mat();
+        }
+        if (width <= 0 || height <= 0 || (channels != 1 && channels != 3 && channels != 4) || stride < static_cast<size_t>(width) * channels)
+        {
+            set_state(CODE_ERR_RAW_PARAM, MSG_ERR_RAW_PARAM); // Report status: parameters out of range
+            return cv::Mat();
+        }
+        // Padding after the last row is not required. A stride too large to address saturates and fails the check.
+        size_t needed = raw_image_bytes(static_cast<size_t>(width) * channels, height, stride);
+        if (data == nullptr || length < needed)
+        {
+            set_state(CODE_ERR_RAW_SIZE, MSG_ERR_RAW_SIZE(needed, length)); // Report status: not enough pixel data
+            return cv::Mat();
+        }
+        cv::Mat mat(height, width, CV_MAKETYPE(CV_8U, channels), data, stride);
+        if (channels == 3)
+        { // BGR, PPOCR can recognize, return directly
+            return mat;
+        }
+        // Gray or BGRA, convert to 3 channels
+        cv::Mat mat_c3;
+        cv::cvtColor(mat, mat_c3, channels == 4 ? cv::COLOR_BGRA2BGR : cv::COLOR_GRAY2BGR);
+        return mat_c3;
+    }
+
+    // Read image from mapped memory. With width and height in desc, data holds raw pixels (see imread_raw),
+    // otherwise an encoded image file that is decoded straight from the mapping.
+    cv::Mat Task::imread_mapped(const nlohmann::json &desc, char *data, size_t length)
+    {
+        if (desc.contains("width"))
+        {
+            return imread_raw(desc, data, length); // Pixels stay in the mapping, keep t_mapping until OCR is done
+        }
+        cv::_InputArray array(data, length);
+        cv::Mat img = cv::imdecode(array, cv::IMREAD_COLOR);
+        t_mapping.reset(); // cv::imdecode() copied the data, mapping is no longer needed
+        if (img.empty())
+        {
+            set_state(CODE_ERR_SHM_DECODE, MSG_ERR_SHM_DECODE(t_path)); // Report status: convert to Mat failed
+        }
+        return img;
+    }
+
+    // Input json string, parse and read Mat.
+    // In framed mode the json may be followed by '\0' and binary data, which image_raw and image_data read from.
     cv::Mat Task::imread_json(std::string &str_in)
     {
 #ifdef ENABLE_REMOTE_EXIT
@@ -147,24 +818,86 @@ namespace PaddleOCR
             return cv::Mat();
         }
 #endif
+        t_keep_alive = false;
+        t_mapping.reset();
+        t_full_loader = nullptr;
+        t_batch = false;
+        t_images.clear();
+        t_id.clear();
+        t_deadline = std::chrono::steady_clock::time_point::max();
+        t_bulk = false;
+        t_params = default_params();
+        t_format = FORMAT_JSON;
+        t_stream = false;
+        // deadline_ms counts from the arrival of the request, which is now unless it waited in a queue before
+        std::chrono::steady_clock::time_point received = t_received;
+        if (received == std::chrono::steady_clock::time_point())
+            received = std::chrono::steady_clock::now();
+        t_received = std::chrono::steady_clock::time_point();
         cv::Mat img;
         bool is_image_found = false; // Whether image is found currently
         std::string logstr = "";
-        // Parse to json object
-        auto j = nlohmann::json();
+        // Split off binary data attached after the json
+        size_t json_end = str_in.find('\0');
+        char *attach = nullptr;
+        size_t attach_len = 0;
+        if (json_end != std::string::npos)
+        {
+            attach = &str_in[json_end + 1];
+            attach_len = str_in.length() - json_end - 1;
+        }
+        else
+        {
+            json_end = str_in.length();
+        }
+        // Split into key-value pairs. Values stay in str_in, so the base64 string is never copied
+        std::vector<JsonMember> members;
+        bool is_object;
         try
         {
-            j = nlohmann::json::parse(str_in); // Convert to json object
+            is_object = json_split_object(str_in.data(), str_in.data() + json_end, members);
         }
         catch (...)
+        {
+            is_object = false;
+        }
+        if (!is_object)
         {
             set_state(CODE_ERR_JSON_PARSE, MSG_ERR_JSON_PARSE); // Report status: parsing failed
             return cv::Mat();
         }
-        for (auto &el : j.items())
+        for (auto &member : members)
+        { // Take the request id and the response format first, so that error responses carry them as well
+            try
+            {
+                if (member.key == "id")
+                {
+                    t_id = nlohmann::json::parse(member.begin, member.end).dump(-1, ' ', FLAGS_ensure_ascii);
+                }
+                else if (member.key == "format")
+                { // Response encoding, "json" (default), "msgpack" or "cbor"
+                    std::string format = nlohmann::json::parse(member.begin, member.end).get<std::string>();
+                    if (format == "json")
+                        t_format = FORMAT_JSON;
+                    else if (format == "msgpack")
+                        t_format = FORMAT_MSGPACK;
+                    else if (format == "cbor")
+                        t_format = FORMAT_CBOR;
+                    else
+                        throw std::invalid_argument("Unknown format.");
+                }
+            }
+            catch (...)
+            {
+                set_state(CODE_ERR_JSON_PARSE_KEY, MSG_ERR_JSON_PARSE_KEY(member.key)); // Report status: parse key failed
+                return cv::Mat();
+            }
+        }
+        for (auto &member : members)
         { // Traverse key-value pairs
+            const std::string &key = member.key;
 #ifdef ENABLE_REMOTE_EXIT
-            if (el.key() == "exit")
+            if (key == "exit")
             { // Exit command
                 is_exit = true;
                 return cv::Mat();
@@ -172,35 +905,59 @@ namespace PaddleOCR
 #endif
             try
             {
-                std::string value = to_string(el.value());
-                int vallen = value.length();
-                if (vallen > 2 && value[0] == '\"' && value[vallen - 1] == '\"')
-                {
-                    value = value.substr(1, vallen - 2); // Remove quotes from both ends of nlohmann string
-                }
                 // Extract image
                 if (!is_image_found)
                 {
-                    if (el.key() == "image_base64")
-                    {                                // base64 string
-                        FLAGS_image_path = "base64"; // Set image path flag for output when no text
-                        img = imread_base64(value);  // Read image
+                    if (key == "images")
+                    { // Batch of images, read into t_images
+                        imread_batch(member, attach, attach_len);
+                        t_batch = true;
                         is_image_found = true;
+                        continue;
                     }
-#ifdef ENABLE_JSON_IMAGE_PATH
-                    else if (el.key() == "image_path")
-                    { // Image path
-                        FLAGS_image_path = value;
-                        img = imread_u8(value); // Read image
+                    if (imread_member(member, attach, attach_len, img, true))
+                    {
                         is_image_found = true;
+                        continue;
                     }
-#endif
                 }
-                // else {} // TODO: Other parameters hot update
+                // Other values are small, parse them as json
+                nlohmann::json value = nlohmann::json::parse(member.begin, member.end);
+                if (key == "keep_alive")
+                { // Keep socket connection open after this request
+                    t_keep_alive = value.is_boolean() ? value.get<bool>() : (value == 1 || value == "1");
+                }
+                else if (key == "stream")
+                { // Send the lines as they are found, before the final response
+                    t_stream = value.get<bool>();
+                }
+                else if (key == "deadline_ms")
+                { // Stop OCR after this many milliseconds and answer with the text recognized so far
+                    if (!value.is_number())
+                        throw std::invalid_argument("deadline_ms is not a number.");
+                    double ms = value.get<double>();
+                    if (std::isnan(ms) || ms < 0)
+                        throw std::invalid_argument("deadline_ms is negative or not a number.");
+                    const double max_deadline_ms = 24.0 * 3600 * 1000; // Longer deadlines never pass, and would overflow the clock
+                    if (ms > 0 && ms <= max_deadline_ms)
+                        t_deadline = received + std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                                                    std::chrono::duration<double, std::milli>(ms));
+                }
+                else if (key == "priority")
+                { // Scheduling lane, "interactive" (default) or "bulk"
+                    std::string priority = value.get<std::string>();
+                    if (priority != "interactive" && priority != "bulk")
+                        throw std::invalid_argument("Unknown priority.");
+                    t_bulk = priority == "bulk";
+                }
+                else
+                { // OCR parameter override for this request only, unknown keys are ignored
+                    read_param(key, value);
+                }
             }
             catch (...)
-            {                                                                         // For safety, end this task when unknown exception occurs
-                set_state(CODE_ERR_JSON_PARSE_KEY, MSG_ERR_JSON_PARSE_KEY(el.key())); // Report status: parse key failed
+            {                                                                    // For safety, end this task when unknown exception occurs
+                set_state(CODE_ERR_JSON_PARSE_KEY, MSG_ERR_JSON_PARSE_KEY(key)); // Report status: parse key failed
                 return cv::Mat();
             }
         }
@@ -211,33 +968,439 @@ namespace PaddleOCR
         return img;
     }
 
+    // Read the image named by one request member into img. Return false if the member is not an image key.
+    bool Task::imread_member(const JsonMember &member, char *attach, size_t attach_len, cv::Mat &img, bool reduce)
+    {
+        const std::string &key = member.key;
+        if (key == "image_base64")
+        { // base64 string, decode straight from the request text
+            t_path = "base64"; // Set image path for output when no text
+            std::string storage;
+            const char *b64;
+            size_t b64_len;
+            json_string_text(member, storage, b64, b64_len);
+            img = imread_base64(b64, b64_len, cv::IMREAD_COLOR, reduce); // Read image
+            return true;
+        }
+        if (key != "image_shm" && key != "image_fd" && key != "image_raw" && key != "image_data" && key != "image_path")
+        {
+            return false;
+        }
+        // Image descriptions are small, parse them as json
+        nlohmann::json value = nlohmann::json::parse(member.begin, member.end);
+        if (key == "image_shm")
+        {                            // Shared memory segment
+            img = imread_shm(value); // Map image
+            return true;
+        }
+#if defined(_LINUX) || defined(__linux__)
+        if (key == "image_fd")
+        {                  // File descriptor passed over the unix socket
+            t_path = "fd"; // Set image path for output when no text
+            if (t_fd < 0)
+                set_state(CODE_ERR_FD_NONE, MSG_ERR_FD_NONE);
+            else
+                img = imread_fd(t_fd, value); // Map image
+            return true;
+        }
+#endif
+        if (key == "image_raw")
+        {                   // Raw pixels attached after the json, from offset (default 0) on
+            t_path = "raw"; // Set image path for output when no text
+            size_t offset = value.value("offset", static_cast<size_t>(0));
+            if (offset > attach_len)
+                img = imread_raw(value, nullptr, 0); // Reports too short data
+            else
+                img = imread_raw(value, attach + offset, attach_len - offset); // Wrap image
+            return true;
+        }
+        if (key == "image_data")
+        {                    // Encoded image file attached after the json, from offset (default 0) on
+            t_path = "data"; // Set image path for output when no text
+            size_t offset = value.value("offset", static_cast<size_t>(0));
+            if (offset < attach_len)
+            {
+                cv::_InputArray array(attach + offset, attach_len - offset);
+                img = cv::imdecode(array, cv::IMREAD_COLOR);
+            }
+            if (img.empty())
+                set_state(CODE_ERR_DATA_DECODE, MSG_ERR_DATA_DECODE); // Report status: convert to Mat failed
+            return true;
+        }
+#ifdef ENABLE_JSON_IMAGE_PATH
+        if (key == "image_path")
+        { // Image path
+            t_path = value.get<std::string>();
+            img = imread_u8(t_path, cv::IMREAD_COLOR, reduce); // Read image
+            return true;
+        }
+#endif
+        return false;
+    }
+
+    // Read the images of a batch request ("images": [{...}, ...]) into t_images.
+    // Each element takes one of the image keys of a single request. An element that fails to read
+    // only fails its own result, so the status of every image is kept next to it.
+    void Task::imread_batch(const JsonMember &member, char *attach, size_t attach_len)
+    {
+        std::vector<std::pair<const char *, const char *>> elements;
+        if (!json_split_array(member.begin, member.end, elements))
+        {
+            throw std::invalid_argument("Json value is not an array.");
+        }
+        t_images.clear();
+        t_images.resize(elements.size());
+        for (size_t i = 0; i < elements.size(); i++)
+        {
+            OCRImage &image = t_images[i];
+            set_state(); // Initialize state
+            t_path = "";
+            std::string key;
+            try
+            {
+                std::vector<JsonMember> members;
+                if (!json_split_object(elements[i].first, elements[i].second, members))
+                {
+                    throw std::invalid_argument("Json value is not an object.");
+                }
+                bool is_image_found = false;
+                for (auto &m : members)
+                {
+                    key = m.key;
+                    if (imread_member(m, attach, attach_len, image.img))
+                    {
+                        is_image_found = true;
+                        break;
+                    }
+                }
+                if (!is_image_found)
+                {
+                    set_state(CODE_ERR_NO_TASK, MSG_ERR_NO_TASK); // Report status: no valid task found
+                }
+            }
+            catch (...)
+            {
+                image.img = cv::Mat();
+                if (key.empty())
+                    set_state(CODE_ERR_JSON_PARSE, MSG_ERR_JSON_PARSE); // Report status: parsing failed
+                else
+                    set_state(CODE_ERR_JSON_PARSE_KEY, MSG_ERR_JSON_PARSE_KEY(key)); // Report status: parse key failed
+            }
+            image.code = t_code;
+            image.msg = t_msg;
+            image.path = t_path;
+            image.mapping = std::move(t_mapping); // Every image keeps its own mapping
+            t_mapping.reset();
+        }
+        set_state();
+    }
+
+    // Takes the settings of one request off the engine when it goes out of scope, also when OCR throws,
+    // so that the next request of the worker does not inherit them
+    struct EngineRequestGuard
+    {
+        PPOCR &ppocr;
+        explicit EngineRequestGuard(PPOCR &engine) : ppocr(engine) {}
+        ~EngineRequestGuard()
+        {
+            ppocr.set_line_hook(nullptr);
+            ppocr.set_full_image();
+            ppocr.set_rois();
+            ppocr.set_det_params();
+            ppocr.set_deadline();
+        }
+    };
+
+    // Results of earlier requests, shared by all workers
+    static ResultCache &result_cache()
+    {
+        static ResultCache cache(static_cast<size_t>(std::max(FLAGS_cache_mb, 0)) << 20);
+        return cache;
+    }
+
+    // Cache key of an image: hash of its pixels, plus everything else that changes the result
+    std::string Task::result_key(const cv::Mat &img)
+    {
+        XXH64_hash_t hash = 0;
+        size_t row_bytes = img.cols * img.elemSize();
+        for (int r = 0; r < img.rows; r++)
+        { // Row by row, so that padding between rows does not change the hash
+            hash = XXH64(img.ptr(r), row_bytes, hash);
+        }
+        const DBDetectorParams &det = t_params.det_params;
+        char key[256];
+        snprintf(key, sizeof(key), "%016llx %dx%dx%d %d%d%d %s %d %g %g %g %s %d",
+                 static_cast<unsigned long long>(hash), img.cols, img.rows, img.type(),
+                 t_params.det, t_params.rec, t_params.cls, det.limit_type.c_str(), det.limit_side_len,
+                 det.det_db_thresh, det.det_db_box_thresh, det.det_db_unclip_ratio, det.det_db_score_mode.c_str(),
+                 static_cast<int>(t_format)); // Results are cached in the format they were written in
+        std::string key_str = key;
+        for (const cv::Rect &roi : t_params.rois)
+        {
+            snprintf(key, sizeof(key), " %d,%d,%d,%d", roi.x, roi.y, roi.width, roi.height);
+            key_str += key;
+        }
+        return key_str;
+    }
+
     // ==================== Task Flow ====================
 
-    std::string Task::run_ocr(std::string str_in)
+    std::string Task::run_ocr(std::string &str_in)
     {
         cv::Mat img = imread_json(str_in);
         if (is_exit)
         { // Exit
             return "";
         }
-        if (img.empty())
+        return run_image(img);
+    }
+
+    std::string Task::run_image(cv::Mat &img)
+    {
+        std::string str_out;
+        const char *missing = nullptr; // Model the request enables, but the engine does not have
+        if (t_params.det && !ppocr->detector_)
+            missing = "det";
+        else if (t_params.rec && !ppocr->recognizer_)
+            missing = "rec";
+        if (missing != nullptr && (t_batch || !img.empty()))
+        {
+            set_state(CODE_ERR_NO_MODEL, MSG_ERR_NO_MODEL(missing));
+            str_out = get_state_json();
+            img.release();
+            t_images.clear();
+            t_mapping.reset();
+            t_full_loader = nullptr;
+        }
+        else if (t_batch)
+        { // Batch of images
+            str_out = run_ocr_batch();
+        }
+        else if (img.empty())
         { // Read image failed
-            return get_state_json();
+            str_out = get_state_json();
         }
-        // Execute OCR
-        std::vector<OCRPredictResult> res_ocr = ppocr->ocr(img, FLAGS_det, FLAGS_rec, FLAGS_cls);
-        // Get result
-        std::string res_json = get_ocr_result_json(res_ocr);
-        // Result 1: Recognition successful, no text (rec not detected)
-        if (res_json.empty())
+        else
         {
-            return get_state_json(CODE_OK_NONE, MSG_OK_NONE(FLAGS_image_path));
+            if (t_full_loader)
+            { // The image was decoded reduced. Requests that detect on it differently than the startup flags assumed need it whole.
+                const DBDetectorParams &det_params = t_params.det_params;
+                if (!t_params.det || !t_params.rois.empty() || det_params.limit_type != "max" ||
+                    std::max(img.cols, img.rows) < det_params.limit_side_len)
+                {
+                    cv::Mat full = t_full_loader();
+                    if (!full.empty())
+                        img = full;
+                    t_full_loader = nullptr;
+                }
+            }
+            // The same image with the same parameters as an earlier request is answered from the cache
+            ResultCache &cache = result_cache();
+            std::string key;
+            bool hit = false;
+            bool owner = false;
+            if (cache.enabled())
+            {
+                key = result_key(img);
+                hit = cache.acquire(key, str_out, owner, t_deadline);
+            }
+            if (!hit)
+            {
+                try
+                {
+                    // Execute OCR
+                    std::vector<OCRPredictResult> res_ocr;
+                    {
+                        EngineRequestGuard guard(*ppocr);
+                        ppocr->set_deadline(t_deadline);
+                        ppocr->set_det_params(t_params.det_override ? &t_params.det_params : nullptr);
+                        ppocr->set_rois(t_params.rois.empty() ? nullptr : &t_params.rois);
+                        ppocr->set_full_image(t_full_loader);
+                        if (t_stream && t_stream_sink)
+                        { // The first lines handed out are the detected boxes, unless det is off
+                            bool detected = t_params.det;
+                            ppocr->set_line_hook([this, detected](const std::vector<OCRPredictResult> &lines, const std::vector<int> &indices) mutable
+                                                 {
+                                stream_lines(lines, indices, detected);
+                                detected = false; });
+                        }
+                        res_ocr = ppocr->ocr(img, t_params.det, t_params.rec, t_params.cls);
+                    }
+                    // Get result
+                    bool timeout = ppocr->is_timeout();
+                    str_out = t_format == FORMAT_JSON ? get_ocr_result_json(res_ocr, timeout) : get_ocr_result_bin(res_ocr, timeout);
+                    if (owner)
+                        cache.finish(key, timeout ? nullptr : &str_out); // Partial results are not cached
+                }
+                catch (...)
+                {
+                    if (owner)
+                        cache.finish(key, nullptr); // Requests waiting for this result compute it themselves
+                    throw;
+                }
+            }
+            img.release();
+            t_mapping.reset(); // Unmap shared memory pixels
+            t_full_loader = nullptr;
+            // Result 1: Recognition successful, no text (rec not detected)
+            if (str_out.empty())
+            {
+                str_out = get_state_json(CODE_OK_NONE, MSG_OK_NONE(t_path));
+            }
+            // Result 2: Recognition successful, with text
         }
-        // Result 2: Recognition successful, with text
-        else
+        if (!t_id.empty())
+        { // Echo the request id, so the client can match out-of-order responses
+            str_out = add_response_field(std::move(str_out), "id", t_id);
+        }
+        return str_out;
+    }
+
+    // Parse and decode a request without running OCR. Used by the reader of the pipelined pipe mode.
+    void Task::read_request(OCRRequest &request)
+    {
+        set_state(); // Initialize state
+        t_path.clear();
+        request.image.img = imread_json(request.payload);
+        request.image.code = t_code;
+        request.image.msg = t_msg;
+        request.image.path = t_path;
+        request.image.mapping = std::move(t_mapping);
+        request.image.full_loader = std::move(t_full_loader);
+        request.batch = t_batch;
+        request.images = std::move(t_images);
+        request.id = t_id;
+        request.deadline = t_deadline;
+        request.bulk = t_bulk;
+        request.params = t_params;
+        request.format = t_format;
+        request.stream = t_stream;
+        t_mapping.reset();
+        t_full_loader = nullptr;
+        t_images.clear();
+    }
+
+    // OCR a request decoded by read_request on another task
+    std::string Task::run_request(OCRRequest &request)
+    {
+        set_state(request.image.code, request.image.msg);
+        t_path = request.image.path;
+        t_mapping = std::move(request.image.mapping);
+        t_full_loader = std::move(request.image.full_loader);
+        t_batch = request.batch;
+        t_images = std::move(request.images);
+        t_id = request.id;
+        t_deadline = request.deadline;
+        t_params = request.params;
+        t_format = request.format;
+        t_stream = request.stream;
+        std::string str_out = run_image(request.image.img);
+        request.image.img.release();
+        t_mapping.reset();
+        return str_out;
+    }
+
+    std::string Task::run_ocr_batch()
+    {
+        // OCR all readable images in one call, so text lines of all images are recognized in shared batches
+        std::vector<cv::Mat> img_list;
+        for (auto &image : t_images)
+        {
+            if (!image.img.empty())
+                img_list.push_back(image.img);
+        }
+        std::vector<std::vector<OCRPredictResult>> res_ocr;
+        if (!img_list.empty())
         {
-            return res_json;
+            EngineRequestGuard guard(*ppocr);
+            ppocr->set_deadline(t_deadline);
+            ppocr->set_det_params(t_params.det_override ? &t_params.det_params : nullptr);
+            ppocr->set_rois(t_params.rois.empty() ? nullptr : &t_params.rois);
+            res_ocr = ppocr->ocr(img_list, t_params.det, t_params.rec, t_params.cls);
         }
+        img_list.clear();
+        bool timeout = !res_ocr.empty() && ppocr->is_timeout();
+
+        // One result per image, in request order. Each is what a single request with that image would return
+        t_json.clear();
+        if (t_format != FORMAT_JSON)
+        {
+            bool cbor = t_format == FORMAT_CBOR;
+            bin_begin_response(t_json, cbor, timeout ? 3 : 2);
+            bin_append_string(t_json, cbor, "code");
+            bin_append_int(t_json, cbor, timeout ? CODE_ERR_TIMEOUT : CODE_OK);
+            bin_append_string(t_json, cbor, "data");
+            bin_append_array(t_json, cbor, t_images.size());
+            size_t k = 0;
+            for (auto &image : t_images)
+            {
+                if (image.img.empty())
+                { // Read image failed
+                    write_state_bin(t_json, image.code, image.msg);
+                    continue;
+                }
+                size_t begin = t_json.size();
+                try
+                {
+                    size_t count = write_ocr_result_bin(t_json, res_ocr[k++], timeout ? CODE_ERR_TIMEOUT : CODE_OK);
+                    if (count == 0 && !timeout)
+                    { // Recognition successful, no text
+                        t_json.resize(begin);
+                        write_state_bin(t_json, CODE_OK_NONE, MSG_OK_NONE(image.path));
+                    }
+                }
+                catch (...)
+                { // Text is not valid UTF-8
+                    t_json.resize(begin);
+                    write_state_bin(t_json, CODE_ERR_JSON_DUMP, MSG_ERR_JSON_DUMP);
+                }
+            }
+            if (timeout)
+            {
+                bin_append_string(t_json, cbor, "msg");
+                bin_append_string(t_json, cbor, MSG_ERR_TIMEOUT);
+            }
+            t_images.clear(); // Also unmaps shared memory pixels
+            return t_json;
+        }
+        t_json += "{\"code\":";
+        json_append_int(t_json, timeout ? CODE_ERR_TIMEOUT : CODE_OK);
+        t_json += ",\"data\":[";
+        size_t k = 0;
+        for (auto &image : t_images)
+        {
+            if (&image != &t_images.front())
+                t_json += ',';
+            if (image.img.empty())
+            { // Read image failed
+                t_json += get_state_json(image.code, image.msg);
+                continue;
+            }
+            size_t begin = t_json.size();
+            try
+            { // Every image shares the deadline, the result of each may be cut short
+                size_t count = write_ocr_result(t_json, res_ocr[k++], timeout ? CODE_ERR_TIMEOUT : CODE_OK);
+                if (count == 0 && !timeout)
+                { // Recognition successful, no text
+                    t_json.resize(begin);
+                    t_json += get_state_json(CODE_OK_NONE, MSG_OK_NONE(image.path));
+                }
+            }
+            catch (...)
+            { // Text is not valid UTF-8
+                t_json.resize(begin);
+                t_json += get_state_json(CODE_ERR_JSON_DUMP, MSG_ERR_JSON_DUMP);
+            }
+        }
+        t_json += ']';
+        if (timeout)
+        {
+            t_json += ",\"msg\":";
+            json_append_string(t_json, MSG_ERR_TIMEOUT, true);
+        }
+        t_json += '}';
+        t_images.clear(); // Also unmaps shared memory pixels
+        return t_json;
     }
 
     void Task::init_engine()
@@ -249,6 +1412,11 @@ namespace PaddleOCR
         std::cerr << "OCR init time: " << duration.count() << "s" << std::endl;
     }
 
+    void Task::clone_engine(const Task &base, bool det, bool cls, bool rec)
+    {
+        this->ppocr.reset(new PPOCR(*base.ppocr, det, cls, rec)); // Predictors share weights with base engine
+    }
+
     void Task::memory_check_cleanup()
     {
         /*int mem1 = Task::get_memory_mb();
@@ -320,30 +1488,51 @@ namespace PaddleOCR
     {
         Task::init_engine(); // Initialize engine
         int flag;
+        // Batch mode may write its results to stdout, so its mode lines go to stderr
+        bool batch = FLAGS_image_path.empty() && (!FLAGS_image_dir.empty() || !FLAGS_manifest.empty());
+        std::ostream &status = batch ? std::cerr : std::cout;
 
 #if defined(_WIN32) && defined(ENABLE_CLIPBOARD)
-        std::cout << "OCR clipboard enbaled." << std::endl;
+        status << "OCR clipboard enbaled." << std::endl;
 #endif
 
         // Single image recognition mode
         if (!FLAGS_image_path.empty())
         {
-            std::cout << "OCR single image mode. Path: " << FLAGS_image_path << std::endl;
+            status << "OCR single image mode. Path: " << FLAGS_image_path << std::endl;
             flag = 1;
         }
+        // Batch mode over a directory or a file list
+        else if (!FLAGS_image_dir.empty() || !FLAGS_manifest.empty())
+        {
+            status << "OCR batch mode. Images: " << (FLAGS_image_dir.empty() ? FLAGS_manifest : FLAGS_image_dir) << std::endl;
+            flag = 4;
+        }
+        // Unix domain socket server mode
+        else if (!FLAGS_unix_socket.empty())
+        {
+            status << "OCR unix socket mode. Path: " << FLAGS_unix_socket << std::endl;
+            flag = 2;
+        }
         // Socket server mode
         else if (FLAGS_port >= 0 && !FLAGS_addr.empty())
         {
-            std::cout << "OCR socket mode. Addr: " << FLAGS_addr << ", Port: " << FLAGS_port << std::endl;
+            status << "OCR socket mode. Addr: " << FLAGS_addr << ", Port: " << FLAGS_port << std::endl;
+            flag = 2;
+        }
+        // HTTP server mode, runs on the socket server
+        else if (FLAGS_http_port >= 0 && !FLAGS_addr.empty())
+        {
+            status << "OCR http mode. Addr: " << FLAGS_addr << ", Port: " << FLAGS_http_port << std::endl;
             flag = 2;
         }
         // Anonymous pipe mode
         else
         {
-            std::cout << "OCR anonymous pipe mode." << std::endl;
+            status << "OCR anonymous pipe mode." << std::endl;
             flag = 3;
         }
-        std::cout << "OCR init completed." << std::endl;
+        status << "OCR init completed." << std::endl;
 
         switch (flag)
         {
@@ -353,6 +1542,8 @@ namespace PaddleOCR
             return socket_mode();
         case 3:
             return anonymous_pipe_mode();
+        case 4:
+            return batch_mode();
         }
         return 0;
     }
@@ -361,14 +1552,20 @@ namespace PaddleOCR
     int Task::single_image_mode()
     {
         set_state();
-        cv::Mat img = imread_u8(FLAGS_image_path);
+        cv::Mat img = imread_u8(FLAGS_image_path, cv::IMREAD_COLOR, FLAGS_det); // A huge scan is decoded reduced for detection
         if (img.empty())
         { // Read image failed
             std::cout << get_state_json() << std::endl;
             return 0;
         }
         // Execute OCR
-        std::vector<OCRPredictResult> res_ocr = ppocr->ocr(img, FLAGS_det, FLAGS_rec, FLAGS_cls);
+        std::vector<OCRPredictResult> res_ocr;
+        {
+            EngineRequestGuard guard(*ppocr);
+            ppocr->set_full_image(t_full_loader); // Lines are cropped from the full resolution image
+            res_ocr = ppocr->ocr(img, FLAGS_det, FLAGS_rec, FLAGS_cls);
+        }
+        t_full_loader = nullptr;
         // Get result
         std::string res_json = get_ocr_result_json(res_ocr);
         // Result 1: Recognition successful, no text (rec not detected)
@@ -384,29 +1581,352 @@ namespace PaddleOCR
         return 0;
     }
 
+    // Read one request from stdin: a line, or with -framed a 4-byte big-endian length followed by that many bytes.
+    // Return false at end of input. An oversized frame is skipped and its error response is put into str_out.
+    static bool pipe_read(std::string &str_in, std::string &str_out)
+    {
+        str_out.clear();
+        if (!FLAGS_framed)
+        {
+            return static_cast<bool>(getline(std::cin, str_in));
+        }
+        static const uint32_t max_length = static_cast<uint32_t>(std::min<int64_t>(int64_t(FLAGS_max_frame_mb) << 20, UINT32_MAX));
+        // Read length header
+        uint32_t length;
+        if (!std::cin.read(reinterpret_cast<char *>(&length), sizeof(length)))
+            return false;
+        length = ntohl(length);
+        if (length > max_length)
+        { // Skip the oversized body so the next frame can still be read
+            std::cin.ignore(length);
+            nlohmann::json j;
+            j["code"] = CODE_ERR_FRAME_SIZE;
+            j["data"] = MSG_ERR_FRAME_SIZE(length);
+            str_out = j.dump(-1, ' ', FLAGS_ensure_ascii);
+            return true;
+        }
+        // Read the whole body into the payload in one go
+        str_in.resize(length);
+        return length == 0 || static_cast<bool>(std::cin.read(&str_in[0], length));
+    }
+
+    // Write one response to stdout, as a line or a frame
+    static void pipe_write(const std::string &str_out)
+    {
+        if (FLAGS_framed)
+        {
+            uint32_t header = htonl(static_cast<uint32_t>(str_out.length()));
+            std::cout.write(reinterpret_cast<const char *>(&header), sizeof(header));
+            std::cout.write(str_out.data(), str_out.length());
+            std::cout.flush();
+        }
+        else
+        {
+            std::cout << str_out << std::endl;
+        }
+    }
+
     // Anonymous pipe mode
     int Task::anonymous_pipe_mode()
     {
+#ifdef _WIN32
+        if (FLAGS_framed)
+        { // Frames are binary, the CRT must not translate line breaks
+            _setmode(_fileno(stdin), _O_BINARY);
+            _setmode(_fileno(stdout), _O_BINARY);
+        }
+#endif
+        if (FLAGS_pipeline)
+            return pipelined_pipe_mode();
+        std::string str_in; // Payload buffer, reused across requests
+        t_stream_sink = [this](std::string record)
+        { // Binary records need frames to be told apart
+            if (FLAGS_framed || t_format == FORMAT_JSON)
+                pipe_write(encode_response(std::move(record), FLAGS_framed));
+        };
         while (1)
         {
             set_state(); // Initialize state
-            // Read one line of input
-            std::string str_in;
-            getline(std::cin, str_in);
-            // Get ocr result and output
-            std::string str_out = run_ocr(str_in);
-            if (is_exit)
-            { // Exit
+            // Read one request, end of input closes the pipe mode
+            std::string str_out;
+            if (!pipe_read(str_in, str_out))
                 return 0;
+            if (str_out.empty())
+            {
+                // Get ocr result
+                str_out = run_ocr(str_in);
+                if (is_exit)
+                { // Exit
+                    return 0;
+                }
+                str_out = encode_response(std::move(str_out), FLAGS_framed);
             }
             // Send back result
-            std::cout << str_out << std::endl;
+            pipe_write(str_out);
             // Check and cleanup memory
             Task::memory_check_cleanup();
         }
         return 0;
     }
 
+    // Pipelined anonymous pipe mode.
+    // The main thread keeps reading and decoding upcoming requests while the worker pool runs OCR.
+    // Responses are written as soon as they are ready, so they may come back out of request order;
+    // clients match them by the "id" they put into each request.
+    int Task::pipelined_pipe_mode()
+    {
+        std::mutex outMutex; // Each response is written in one piece
+        std::mutex flightMutex;
+        std::condition_variable flightCond;
+        int inFlight = 0;
+        // Decode at most this many requests ahead, so a fast writer cannot fill memory with images
+        const int maxInFlight = std::max(FLAGS_workers, 1) * 2;
+        Task reader;                        // Parses and decodes requests, has no engine
+        TaskPool pool(*this, FLAGS_workers, FLAGS_bulk_share); // Declared last: its destructor finishes queued requests first
+        while (1)
+        {
+            {
+                std::unique_lock<std::mutex> lock(flightMutex);
+                flightCond.wait(lock, [&]
+                                { return inFlight < maxInFlight; });
+            }
+            // Read one request, end of input closes the pipe mode
+            std::shared_ptr<OCRRequest> request = std::make_shared<OCRRequest>();
+            std::string str_out;
+            if (!pipe_read(request->payload, str_out))
+                break;
+            if (!str_out.empty())
+            { // Oversized frame, answer right away
+                std::lock_guard<std::mutex> lock(outMutex);
+                pipe_write(str_out);
+                continue;
+            }
+            // Decode the image on this thread, while the workers are busy with earlier requests
+            reader.read_request(*request);
+            if (reader.is_exit)
+            { // Exit after the requests already read are answered
+                break;
+            }
+            {
+                std::lock_guard<std::mutex> lock(flightMutex);
+                ++inFlight;
+            }
+            pool.submit([request, &outMutex, &flightMutex, &flightCond, &inFlight](Task &worker)
+                        {
+                worker.t_stream_sink = [&worker, &outMutex](std::string record)
+                { // Binary records need frames to be told apart
+                    if (!FLAGS_framed && worker.t_format != FORMAT_JSON)
+                        return;
+                    record = worker.encode_response(std::move(record), FLAGS_framed);
+                    std::lock_guard<std::mutex> lock(outMutex);
+                    pipe_write(record);
+                };
+                // A failed request is answered anyway, with its id, and frees its place in flight below
+                auto failed = [&worker, &request](const std::string &what)
+                {
+                    std::cerr << "OCR failed: " << what << std::endl;
+                    worker.t_format = FORMAT_JSON;
+                    std::string out = worker.get_state_json(CODE_ERR_OCR_FAILED, MSG_ERR_OCR_FAILED(what));
+                    if (!request->id.empty())
+                        out = worker.add_response_field(std::move(out), "id", request->id);
+                    return out;
+                };
+                std::string str_out;
+                try
+                {
+                    str_out = worker.encode_response(worker.run_request(*request), FLAGS_framed);
+                }
+                catch (const std::exception &e)
+                {
+                    str_out = failed(e.what());
+                }
+                catch (...)
+                {
+                    str_out = failed("unknown error");
+                }
+                worker.t_stream_sink = nullptr;
+                request->payload.clear();
+                request->payload.shrink_to_fit();
+                {
+                    std::lock_guard<std::mutex> lock(outMutex);
+                    pipe_write(str_out);
+                }
+                // Check and cleanup memory
+                worker.memory_check_cleanup();
+                {
+                    std::lock_guard<std::mutex> lock(flightMutex);
+                    --inFlight;
+                }
+                flightCond.notify_one(); },
+                        request->bulk);
+        }
+        return 0;
+    }
+
+    // Batch mode: OCR the images of image_dir (sorted by name) and of the manifest file (one path per line) in one process.
+    // Decode threads read images ahead of the OCR workers, at most prefetch decoded images wait for a worker.
+    // Every image gives one JSON line: the usual return value plus its "path", in input order or, with
+    // output_order=completion, as soon as it is ready.
+    int Task::batch_mode()
+    {
+        std::vector<std::string> paths;
+        if (!FLAGS_image_dir.empty())
+        {
+            std::vector<std::string> files;
+            Utility::GetAllFiles(FLAGS_image_dir.c_str(), files);
+            for (auto &file : files)
+            {
+                if (is_image_file(file))
+                    paths.push_back(file);
+            }
+            std::sort(paths.begin(), paths.end());
+        }
+        if (!FLAGS_manifest.empty())
+        {
+            std::ifstream manifest(FLAGS_manifest, std::ios::binary);
+            std::vector<std::string> listed = read_manifest(manifest);
+            paths.insert(paths.end(), listed.begin(), listed.end());
+        }
+        std::ofstream file;
+        if (!FLAGS_batch_output.empty())
+        {
+            file.open(FLAGS_batch_output, std::ios::binary);
+            if (!file)
+            {
+                std::cerr << "[ERROR] Can not open batch_output: " << FLAGS_batch_output << std::endl;
+                return 1;
+            }
+        }
+        std::ostream &out = FLAGS_batch_output.empty() ? std::cout : file;
+        std::cerr << "Batch images: " << paths.size() << std::endl;
+        auto batch_start = std::chrono::steady_clock::now();
+
+        const size_t prefetch = static_cast<size_t>(std::max(FLAGS_prefetch, 1));
+        std::mutex mutex; // Guards the counters below and the output
+        std::condition_variable cond;
+        size_t nextDecode = 0; // Index of the next image to decode
+        size_t waiting = 0;    // Decoded images no worker has taken yet
+        BatchWriter writer(out, FLAGS_output_order == "input");
+        {
+            // With stage_pipeline, det, cls and rec of consecutive images overlap instead of running image by image.
+            // Both are destroyed at the end of this block, after their queued images are done.
+            std::unique_ptr<StagePipeline> stages;
+            std::unique_ptr<TaskPool> pool;
+            if (FLAGS_stage_pipeline)
+            {
+                stages.reset(new StagePipeline(*this, FLAGS_workers, static_cast<int>(prefetch), FLAGS_det, FLAGS_rec, FLAGS_cls));
+                ppocr.reset(); // The stage clones keep the weights, the full engine is not needed any more
+            }
+            else
+                pool.reset(new TaskPool(*this, FLAGS_workers));
+            auto decode = [&]()
+            {
+                Task reader; // Decodes images, has no engine
+                while (true)
+                {
+                    size_t i;
+                    {
+                        std::unique_lock<std::mutex> lock(mutex);
+                        // With stage_pipeline, the det queue holds the images decoded ahead
+                        cond.wait(lock, [&]
+                                  { return nextDecode >= paths.size() || stages || waiting < prefetch; });
+                        if (nextDecode >= paths.size())
+                            return;
+                        i = nextDecode++;
+                        if (!stages)
+                            ++waiting;
+                    }
+                    std::shared_ptr<OCRRequest> request = std::make_shared<OCRRequest>();
+                    request->image.path = paths[i];
+                    request->params = default_params();
+                    try
+                    {
+                        reader.set_state(); // Initialize state
+                        // Huge scans are decoded reduced for detection, the lines are cropped from the full decode
+                        request->image.img = reader.imread_u8(paths[i], cv::IMREAD_COLOR, FLAGS_det);
+                        request->image.full_loader = std::move(reader.t_full_loader);
+                        reader.t_full_loader = nullptr;
+                        request->image.code = reader.t_code;
+                        request->image.msg = reader.t_msg;
+                    }
+                    catch (...)
+                    { // Every image gets its line, a failed one with the error
+                        reader.t_full_loader = nullptr;
+                        request->image.img = cv::Mat();
+                        request->image.code = CODE_ERR_PATH_DECODE;
+                        request->image.msg = MSG_ERR_PATH_DECODE(paths[i]);
+                    }
+                    if (stages && !request->image.img.empty())
+                    { // Waits while the det queue is full
+                        std::function<cv::Mat()> full_loader = std::move(request->image.full_loader);
+                        request->image.full_loader = nullptr;
+                        stages->submit(request->image.img, std::move(full_loader), [i, request, &mutex, &writer](Task &worker, std::vector<OCRPredictResult> &res, const std::string &error)
+                                       {
+                            std::string line;
+                            if (!error.empty())
+                                line = batch_error_line(CODE_ERR_OCR_FAILED, MSG_ERR_OCR_FAILED(error), request->image.path, FLAGS_ensure_ascii);
+                            else
+                            {
+                                line = worker.get_ocr_result_json(res);
+                                if (line.empty())
+                                    line = worker.get_state_json(CODE_OK_NONE, MSG_OK_NONE(request->image.path));
+                                line = worker.add_response_field(std::move(line), "path", batch_path_json(request->image.path, FLAGS_ensure_ascii));
+                            }
+                            std::lock_guard<std::mutex> lock(mutex);
+                            writer.write(i, std::move(line)); });
+                        request->image.img.release();
+                        continue;
+                    }
+                    if (stages)
+                    { // Read failed, answer without OCR
+                        std::string line = batch_error_line(request->image.code, request->image.msg, request->image.path, FLAGS_ensure_ascii);
+                        std::lock_guard<std::mutex> lock(mutex);
+                        writer.write(i, std::move(line));
+                        continue;
+                    }
+                    pool->submit([i, request, &mutex, &cond, &waiting, &writer](Task &worker)
+                                 {
+                        {
+                            std::lock_guard<std::mutex> lock(mutex);
+                            --waiting;
+                        }
+                        cond.notify_all(); // Room to decode the next image
+                        std::string line;
+                        try
+                        {
+                            line = worker.run_request(*request);
+                            line = worker.add_response_field(std::move(line), "path", batch_path_json(request->image.path, FLAGS_ensure_ascii));
+                        }
+                        catch (const std::exception &e)
+                        { // Later lines in input order wait for this one, so it is written in any case
+                            std::cerr << "OCR failed: " << e.what() << std::endl;
+                            line = batch_error_line(CODE_ERR_OCR_FAILED, MSG_ERR_OCR_FAILED(e.what()), request->image.path, FLAGS_ensure_ascii);
+                        }
+                        catch (...)
+                        {
+                            std::cerr << "OCR failed." << std::endl;
+                            line = batch_error_line(CODE_ERR_OCR_FAILED, MSG_ERR_OCR_FAILED("unknown error"), request->image.path, FLAGS_ensure_ascii);
+                        }
+                        {
+                            std::lock_guard<std::mutex> lock(mutex);
+                            writer.write(i, std::move(line));
+                        }
+                        // Check and cleanup memory
+                        worker.memory_check_cleanup(); });
+                }
+            };
+            std::vector<std::thread> decoders;
+            for (int t = 0; t < std::max(FLAGS_decode_threads, 1); t++)
+                decoders.emplace_back(decode);
+            for (auto &t : decoders)
+                t.join();
+        }
+        writer.finish();
+        std::chrono::duration<double> duration = std::chrono::steady_clock::now() - batch_start;
+        std::cerr << "Batch done. Images: " << paths.size() << ", time: " << duration.count() << "s" << std::endl;
+        return 0;
+    }
+
     // Socket server mode, defined in platform
 
     // Other functions
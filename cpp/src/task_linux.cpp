@@ -8,11 +8,29 @@
 #include "include/paddleocr.h"
 #include "include/args.h"
 #include "include/task.h"
+#include "include/task_pool.h"
+#include "include/http.h"
 
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+// Shared memory
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 // Socket
 #include <unistd.h>
 #include <netinet/in.h>
 #include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
 #include <arpa/inet.h>
 // Memory management
 #include <fstream>
@@ -64,52 +82,69 @@ namespace PaddleOCR
     }
 
     // Replace cv imread, receive utf-8 string input, return Mat.
-    cv::Mat Task::imread_u8(std::string pathU8, int flag)
+    // Regular files are mapped read-only and decoded straight from the mapping, without a heap buffer or copy.
+    cv::Mat Task::imread_u8(std::string pathU8, int flag, bool reduce)
     {
-        std::ifstream fileInput;
-        size_t fileLength;
-        char *buffer;
+        int fd = open(pathU8.c_str(), O_RDONLY | O_CLOEXEC);
+        // Path does not exist and cannot output
+        if (fd < 0)
+        {
+            set_state(CODE_ERR_PATH_EXIST, MSG_ERR_PATH_EXIST(pathU8));
+            return cv::Mat();
+        }
+        struct stat st;
+        if (fstat(fd, &st) < 0)
+        {
+            close(fd);
+            set_state(CODE_ERR_PATH_READ, MSG_ERR_PATH_READ(pathU8));
+            return cv::Mat();
+        }
 
-        // Try to read pathU8 into memory
-        try
+        cv::Mat image;
+        if (S_ISREG(st.st_mode) && st.st_size > 0)
         {
-            fileInput.open(pathU8, std::ios::binary);
-            // Path does not exist and cannot output
-            if (!fileInput)
+            size_t fileLength = st.st_size;
+            void *addr = mmap(nullptr, fileLength, PROT_READ, MAP_PRIVATE, fd, 0);
+            close(fd); // The mapping stays valid after closing
+            if (addr == MAP_FAILED)
             {
-                set_state(CODE_ERR_PATH_EXIST, MSG_ERR_PATH_EXIST(pathU8));
+                set_state(CODE_ERR_PATH_READ, MSG_ERR_PATH_READ(pathU8));
                 return cv::Mat();
             }
-
-            // Get file size and read file into memory
-            fileInput.seekg(0, fileInput.end);
-            fileLength = fileInput.tellg();
-            fileInput.seekg(0, fileInput.beg);
-            buffer = new char[fileLength];
-            fileInput.read(buffer, fileLength);
-
+            madvise(addr, fileLength, MADV_SEQUENTIAL); // The decoder reads front to back, read ahead aggressively
+            // Decode memory data into cv::Mat data. cv::imdecode() copies the decoded pixels, so the mapping goes right after,
+            // unless a reduced decode keeps it for decoding the full resolution image later.
+            std::shared_ptr<const void> mapping(addr, [fileLength](const void *p)
+                                                { munmap(const_cast<void *>(p), fileLength); });
+            try
+            {
+                image = imdecode_reducible(static_cast<const char *>(addr), fileLength, flag, reduce, mapping);
+            }
+            catch (...)
+            {
+                image = cv::Mat();
+            }
+        }
+        else
+        { // Pipes and other special files cannot be mapped, read them instead
+            std::vector<char> buffer;
+            char chunk[64 * 1024];
+            ssize_t n;
+            while ((n = read(fd, chunk, sizeof(chunk))) > 0)
+                buffer.insert(buffer.end(), chunk, chunk + n);
+            close(fd);
             // Cannot read
-            if (!fileInput)
+            if (n < 0)
             {
                 set_state(CODE_ERR_PATH_READ, MSG_ERR_PATH_READ(pathU8));
                 return cv::Mat();
             }
+            if (!buffer.empty())
+            {
+                cv::_InputArray array(buffer.data(), static_cast<int>(buffer.size()));
+                image = cv::imdecode(array, flag);
+            }
         }
-        catch (std::exception &err)
-        {
-            // File open failed or read failed, default to read failed here
-            set_state(CODE_ERR_PATH_READ, MSG_ERR_PATH_READ(pathU8));
-            return cv::Mat();
-        }
-
-        // Decode memory data into cv::Mat data
-        cv::_InputArray array(buffer, fileLength);
-        cv::Mat image = cv::imdecode(array, flag);
-        // Release buffer space must be after cv::imdecode(),
-        // because cv::_InputArray() does not copy elements in buffer,
-        // and cv::imdecode() will allocate new memory and copy decoded data when decoding
-        delete[] buffer;
-        fileInput.close();
 
         // Decode failed
         if (image.empty())
@@ -121,15 +156,337 @@ namespace PaddleOCR
         return image;
     }
 
-    int Task::socket_mode()
+    // Read image from a POSIX shared memory segment (name) or a file such as a memfd's /proc/<pid>/fd/<n> (path).
+    // See imread_fd for the other keys of desc.
+    cv::Mat Task::imread_shm(const nlohmann::json &desc)
+    {
+#ifdef ENABLE_JSON_IMAGE_PATH
+        bool is_path = desc.contains("path");
+#else
+        bool is_path = false; // Opening files by path is part of image_path, which the build leaves out
+#endif
+        std::string name = desc.at(is_path ? "path" : "name").get<std::string>();
+        t_path = name; // Set image path for output when no text
+        int fd = is_path ? open(name.c_str(), O_RDONLY | O_CLOEXEC) : shm_open(name.c_str(), O_RDONLY, 0);
+        if (fd < 0)
+        {
+            set_state(CODE_ERR_SHM_OPEN, MSG_ERR_SHM_OPEN(name));
+            return cv::Mat();
+        }
+        cv::Mat img = imread_fd(fd, desc);
+        close(fd); // The mapping stays valid after closing
+        return img;
+    }
+
+    // Map file descriptor and read image from offset (default 0), see imread_mapped.
+    // The mapping is private and read only, raw pixels are used in place without copying.
+    cv::Mat Task::imread_fd(int fd, const nlohmann::json &desc)
+    {
+        size_t offset = desc.value("offset", static_cast<size_t>(0));
+        struct stat st;
+        if (fstat(fd, &st) < 0 || offset >= static_cast<size_t>(st.st_size))
+        {
+            set_state(CODE_ERR_SHM_MAP, MSG_ERR_SHM_MAP(t_path));
+            return cv::Mat();
+        }
+        // mmap offset must be page aligned, map from the page containing offset to the end
+        size_t page = sysconf(_SC_PAGE_SIZE);
+        size_t base = offset / page * page;
+        size_t length = st.st_size - base;
+        void *addr = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, base);
+        if (addr == MAP_FAILED)
+        {
+            set_state(CODE_ERR_SHM_MAP, MSG_ERR_SHM_MAP(t_path));
+            return cv::Mat();
+        }
+        t_mapping.reset(addr, [length](void *p)
+                        { munmap(p, length); });
+        return imread_mapped(desc, static_cast<char *>(addr) + (offset - base), st.st_size - offset);
+    }
+
+    // recv() that also collects file descriptors passed with the data (SCM_RIGHTS over a unix socket) into fds.
+    static ssize_t recv_fds(int fd, char *buffer, size_t length, int flags, std::vector<int> &fds)
+    {
+        const int maxFds = 8; // Per call
+        struct iovec iov;
+        iov.iov_base = buffer;
+        iov.iov_len = length;
+        alignas(struct cmsghdr) char control[CMSG_SPACE(maxFds * sizeof(int))];
+        struct msghdr msg;
+        memset(&msg, 0, sizeof(msg));
+        msg.msg_iov = &iov;
+        msg.msg_iovlen = 1;
+        msg.msg_control = control;
+        msg.msg_controllen = sizeof(control);
+        ssize_t bytesRecv = recvmsg(fd, &msg, flags | MSG_CMSG_CLOEXEC);
+        if (bytesRecv < 0)
+            return bytesRecv;
+        for (struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg); cmsg != nullptr; cmsg = CMSG_NXTHDR(&msg, cmsg))
+        {
+            if (cmsg->cmsg_level != SOL_SOCKET || cmsg->cmsg_type != SCM_RIGHTS)
+                continue;
+            size_t count = (cmsg->cmsg_len - CMSG_LEN(0)) / sizeof(int);
+            const int *passed = reinterpret_cast<const int *>(CMSG_DATA(cmsg));
+            fds.insert(fds.end(), passed, passed + count);
+        }
+        return bytesRecv;
+    }
+
+    // One client connection of the socket server, owned by the event loop
+    struct Connection
+    {
+        int fd = INVALID_SOCKET;
+        std::string in;          // Received bytes not yet consumed by a request
+        size_t scanned = 0;      // Bytes of in already checked for a terminator
+        std::vector<int> fds;    // File descriptors passed along with the request being received
+        std::string out;         // Response being sent
+        size_t outSent = 0;      // Bytes of out already sent
+        bool busy = false;       // A request of this connection is on a worker, nothing else is read meanwhile
+        bool keepAlive = false;  // Last request asked to keep the connection open
+        bool peerClosed = false; // Client shut down its sending side
+        bool closing = false;    // Close once the response is sent (or dropped, if the connection broke while busy)
+        std::unique_ptr<HttpParser> http; // Set for connections of the HTTP server
+        bool httpChunked = true;          // HTTP client accepts chunked responses
+        bool httpStreaming = false;       // Head and streamed records of the HTTP response are out, the final response ends it
+        std::chrono::steady_clock::time_point lastActive = std::chrono::steady_clock::now();
+    };
+
+    // A finished request, handed from a worker back to the event loop
+    struct Completion
+    {
+        uint64_t connId;
+        std::string out;
+        ResultFormat format = FORMAT_JSON; // Encoding of out
+        bool keepAlive = false;
+        bool exit = false;
+        bool partial = false; // Streamed record, the request is still running
+    };
+
+    // Take one complete request off the front of conn.in. A request ends with '\n' or '\0', or when the client
+    // shuts down its sending side. With -framed it is a 4-byte big-endian length followed by the body.
+    // Return 1 when request was filled, 0 when more bytes are needed, -2 when the frame length exceeds maxLength.
+    static int take_request(Connection &conn, std::string &request, uint32_t maxLength, uint32_t &length)
+    {
+        if (FLAGS_framed)
+        {
+            if (conn.in.length() < sizeof(length))
+                return 0;
+            memcpy(&length, conn.in.data(), sizeof(length));
+            length = ntohl(length);
+            if (length > maxLength)
+                return -2;
+            size_t total = sizeof(length) + size_t(length);
+            if (conn.in.length() < total)
+            {
+                conn.in.reserve(total); // Body size is known, grow the buffer once
+                return 0;
+            }
+            request.assign(conn.in, sizeof(length), length);
+            conn.in.erase(0, total);
+            return 1;
+        }
+        size_t end = conn.in.find_first_of(std::string("\n\0", 2), conn.scanned);
+        if (end != std::string::npos)
+        {
+            if (end + 1 == conn.in.length())
+            { // Nothing behind the terminator, hand over the buffer instead of copying the payload
+                conn.in.resize(end);
+                request.swap(conn.in);
+                conn.in.clear();
+            }
+            else
+            {
+                request.assign(conn.in, 0, end);
+                conn.in.erase(0, end + 1);
+            }
+            conn.scanned = 0;
+            return 1;
+        }
+        conn.scanned = conn.in.length();
+        if (conn.peerClosed && !conn.in.empty())
+        { // Whatever is left is the last request
+            request.swap(conn.in);
+            conn.in.clear();
+            conn.scanned = 0;
+            return 1;
+        }
+        return 0;
+    }
+
+    // Receive whatever the socket has ready into conn.in without blocking. Passed file descriptors go to conn.fds.
+    // Return false on connection error.
+    static bool recv_ready(Connection &conn)
+    {
+        const size_t chunkSize = 64 * 1024; // Large chunks keep recv calls few for base64 payloads
+        while (!conn.peerClosed)
+        {
+            size_t want = chunkSize;
+            if (conn.in.capacity() > conn.in.length() + want)
+                want = conn.in.capacity() - conn.in.length(); // Rest of a frame or body whose length is known
+            size_t used = conn.in.length();
+            conn.in.resize(used + want);
+            ssize_t bytesRecv = recv_fds(conn.fd, &conn.in[used], want, MSG_DONTWAIT, conn.fds);
+            conn.in.resize(used + std::max<ssize_t>(bytesRecv, 0));
+            if (bytesRecv < 0)
+            {
+                if (errno == EINTR)
+                    continue;
+                return errno == EAGAIN || errno == EWOULDBLOCK;
+            }
+            if (bytesRecv == 0)
+                conn.peerClosed = true;
+            conn.lastActive = std::chrono::steady_clock::now();
+            if (static_cast<size_t>(bytesRecv) < want)
+                break; // Socket drained
+        }
+        return true;
+    }
+
+    // Send as much of conn.out as the socket takes without blocking. Return false on connection error.
+    static bool send_ready(Connection &conn)
+    {
+        while (conn.outSent < conn.out.length())
+        {
+            ssize_t bytesSent = send(conn.fd, conn.out.data() + conn.outSent, conn.out.length() - conn.outSent, MSG_NOSIGNAL | MSG_DONTWAIT);
+            if (bytesSent < 0)
+            {
+                if (errno == EINTR)
+                    continue;
+                return errno == EAGAIN || errno == EWOULDBLOCK;
+            }
+            conn.outSent += bytesSent;
+            conn.lastActive = std::chrono::steady_clock::now();
+        }
+        return true;
+    }
+
+    // Put an HTTP response into conn.out. HTTP/1.1 clients get a chunked body. The connection is closed
+    // afterwards unless the client keeps it alive.
+    static void set_http_response(Connection &conn, int status, const std::string &contentType, const std::string &body)
+    {
+        bool chunked = conn.httpChunked;
+        conn.out = http_head(status, contentType, conn.keepAlive, chunked, body.length());
+        conn.outSent = 0;
+        if (chunked)
+        {
+            http_chunk(conn.out, body.data(), body.length());
+            http_chunk(conn.out, nullptr, 0);
+        }
+        else
+        {
+            conn.out.append(body);
+        }
+        conn.closing = !conn.keepAlive;
+    }
+
+    // Take one HTTP request off the front of conn.in. POST /ocr takes a request json as body, or an encoded
+    // image file when the content type is image/*. Return 1 when request was filled, 0 when more bytes are
+    // needed, -3 when conn.out got an HTTP response instead (an error, or "100 Continue").
+    static int take_http_request(Connection &conn, std::string &request)
+    {
+        HttpRequest httpRequest;
+        HttpParser::State state = conn.http->parse(conn.in, httpRequest);
+        if (state == HttpParser::HTTP_FAILED)
+        { // The rest of the stream cannot be trusted, answer and close
+            int status = conn.http->error_status();
+            conn.keepAlive = false;
+            conn.httpChunked = false;
+            set_http_response(conn, status, "text/plain", std::string(http_reason(status)) + "\n");
+            return -3;
+        }
+        if (state == HttpParser::HTTP_INCOMPLETE)
+        {
+            if (conn.peerClosed || !conn.http->expects_continue())
+                return 0;
+            conn.out = "HTTP/1.1 100 Continue\r\n\r\n";
+            conn.outSent = 0;
+            return -3;
+        }
+        conn.keepAlive = httpRequest.keep_alive;
+        conn.httpChunked = httpRequest.http_1_1;
+        if (httpRequest.path != "/ocr")
+        {
+            set_http_response(conn, 404, "text/plain", "Not Found\n");
+            return -3;
+        }
+        if (httpRequest.method != "POST")
+        {
+            set_http_response(conn, 405, "text/plain", "Method Not Allowed\n");
+            return -3;
+        }
+        if (httpRequest.content_type.compare(0, 6, "image/") == 0)
+        { // Image file as body, attach it to an image_data request
+            static const std::string head("{\"image_data\":{}}\0", 18);
+            request.reserve(head.length() + httpRequest.body.length());
+            request.assign(head).append(httpRequest.body);
+        }
+        else
+        {
+            request.swap(httpRequest.body);
+        }
+        return 1;
+    }
+
+    // Put a response into conn.out. Framed responses carry a length header, keep-alive responses end with a
+    // line break, so the client can tell them apart.
+    static void set_response(Connection &conn, const std::string &strOut)
+    {
+        conn.out.erase(0, conn.outSent); // Streamed records may still be unsent
+        conn.outSent = 0;
+        if (FLAGS_framed)
+        {
+            uint32_t header = htonl(static_cast<uint32_t>(strOut.length()));
+            conn.out.append(reinterpret_cast<const char *>(&header), sizeof(header));
+        }
+        conn.out.append(strOut);
+        if (!FLAGS_framed && conn.keepAlive)
+            conn.out.push_back('\n');
+    }
+
+    // Put a streamed record of a running request behind whatever of conn.out is unsent. Records are framed like
+    // responses, or end with a line break; over HTTP they are the chunks of one response, json records one per line.
+    static void add_stream_record(Connection &conn, const std::string &record, ResultFormat format, const char *contentType)
+    {
+        conn.out.erase(0, conn.outSent);
+        conn.outSent = 0;
+        if (conn.http)
+        {
+            if (!conn.httpStreaming)
+            {
+                conn.out += http_head(200, format == FORMAT_JSON ? "application/x-ndjson" : contentType, conn.keepAlive, true, 0);
+                conn.httpStreaming = true;
+            }
+            if (format == FORMAT_JSON)
+            {
+                std::string line = record + '\n';
+                http_chunk(conn.out, line.data(), line.length());
+            }
+            else
+            {
+                http_chunk(conn.out, record.data(), record.length());
+            }
+            return;
+        }
+        if (FLAGS_framed)
+        {
+            uint32_t header = htonl(static_cast<uint32_t>(record.length()));
+            conn.out.append(reinterpret_cast<const char *>(&header), sizeof(header));
+        }
+        conn.out.append(record);
+        if (!FLAGS_framed)
+            conn.out.push_back('\n');
+    }
+
+    // Create socket listening on addr (network byte order):port (TCP/IP). Return socket or INVALID_SOCKET.
+    // name is printed in the startup line, e.g. "Socket init completed. 127.0.0.1:1234".
+    static int listen_tcp(uint32_t addr, int port, const char *name)
     {
         // Create socket, protocol family TCP/IP
         int socketFd = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
         if (socketFd == INVALID_SOCKET)
         {
             std::cerr << "Failed to create socket." << std::endl;
-            close(socketFd);
-            return -1;
+            return INVALID_SOCKET;
         }
 
         // Configure address and port number
@@ -137,29 +494,24 @@ namespace PaddleOCR
         // Address family: IPv4
         socketAddr.sin_family = AF_INET;
         // IP address mode: loopback/any/other IPv4
-        if (addr_to_uint32(FLAGS_addr, socketAddr.sin_addr.s_addr) < 0)
-        {
-            std::cerr << "Failed to parse input address." << std::endl;
-            close(socketFd);
-            return -1;
-        }
+        socketAddr.sin_addr.s_addr = addr;
         // Port number
-        socketAddr.sin_port = htons(FLAGS_port);
+        socketAddr.sin_port = htons(port);
 
         // Bind address and port number to socket handle socketFd
         if (bind(socketFd, (struct sockaddr *)&socketAddr, sizeof(socketAddr)) == INVALID_SOCKET)
         {
             std::cerr << "Failed to bind address." << std::endl;
             close(socketFd);
-            return -1;
+            return INVALID_SOCKET;
         }
 
-        // Set socket socketFd to listen state, allow only 1 client to queue connection
-        if (listen(socketFd, 1) == INVALID_SOCKET)
+        // Set socket socketFd to listen state. Clients queue up here until the event loop accepts them
+        if (listen(socketFd, SOMAXCONN) == INVALID_SOCKET)
         {
             std::cerr << "Failed to set listen." << std::endl;
             close(socketFd);
-            return -1;
+            return INVALID_SOCKET;
         }
 
         // Get actual server ip and port
@@ -169,90 +521,523 @@ namespace PaddleOCR
         {
             std::cerr << "Failed to get sockname." << std::endl;
             close(socketFd);
-            return -1;
+            return INVALID_SOCKET;
         }
         // Get port number & ip address
         int serverPort = ntohs(serverAddr.sin_port);
         char *serverIp = inet_ntoa(socketAddr.sin_addr);
-        std::cout << "Socket init completed. " << serverIp << ":" << serverPort << std::endl;
+        std::cout << name << " init completed. " << serverIp << ":" << serverPort << std::endl;
+        return socketFd;
+    }
+
+    // Create unix domain stream socket listening on FLAGS_unix_socket. Return socket or INVALID_SOCKET.
+    static int listen_unix()
+    {
+        struct sockaddr_un socketAddr;
+        if (FLAGS_unix_socket.length() >= sizeof(socketAddr.sun_path))
+        {
+            std::cerr << "Unix socket path is too long." << std::endl;
+            return INVALID_SOCKET;
+        }
+        int socketFd = socket(AF_UNIX, SOCK_STREAM, 0);
+        if (socketFd == INVALID_SOCKET)
+        {
+            std::cerr << "Failed to create socket." << std::endl;
+            return INVALID_SOCKET;
+        }
+        memset(&socketAddr, 0, sizeof(socketAddr));
+        socketAddr.sun_family = AF_UNIX;
+        strcpy(socketAddr.sun_path, FLAGS_unix_socket.c_str());
+
+        // Remove the socket file left by a previous run, then bind
+        unlink(FLAGS_unix_socket.c_str());
+        if (bind(socketFd, (struct sockaddr *)&socketAddr, sizeof(socketAddr)) == INVALID_SOCKET)
+        {
+            std::cerr << "Failed to bind address." << std::endl;
+            close(socketFd);
+            return INVALID_SOCKET;
+        }
+        if (listen(socketFd, SOMAXCONN) == INVALID_SOCKET)
+        {
+            std::cerr << "Failed to set listen." << std::endl;
+            close(socketFd);
+            unlink(FLAGS_unix_socket.c_str());
+            return INVALID_SOCKET;
+        }
+        std::cout << "Socket init completed. " << FLAGS_unix_socket << std::endl;
+        return socketFd;
+    }
 
-        // Loop waiting to receive connections
-        while (true)
+    int Task::socket_mode()
+    {
+        // Listen on a unix domain socket if given, otherwise on TCP/IP. The HTTP server gets its own port.
+        bool isUnix = !FLAGS_unix_socket.empty();
+        bool isSocket = isUnix || FLAGS_port >= 0;
+        bool isHttp = FLAGS_http_port >= 0;
+        uint32_t addr = 0;
+        if ((!isUnix || isHttp) && addr_to_uint32(FLAGS_addr, addr) < 0)
         {
-            // Accept connection request
-            struct sockaddr_in clientAddr;
-            socklen_t clientAddrLen = sizeof(clientAddr);
-            int clientFd = accept(socketFd, (sockaddr *)&clientAddr, &clientAddrLen);
-            if (clientFd == INVALID_SOCKET)
+            std::cerr << "Failed to parse input address." << std::endl;
+            return -1;
+        }
+        int socketFd = INVALID_SOCKET;
+        if (isSocket)
+        {
+            socketFd = isUnix ? listen_unix() : listen_tcp(addr, FLAGS_port, "Socket");
+            if (socketFd == INVALID_SOCKET)
+                return -1;
+            fcntl(socketFd, F_SETFL, fcntl(socketFd, F_GETFL) | O_NONBLOCK);
+        }
+        int httpFd = INVALID_SOCKET;
+        if (isHttp)
+        {
+            httpFd = listen_tcp(addr, FLAGS_http_port, "HTTP");
+            if (httpFd == INVALID_SOCKET)
             {
-                std::cerr << "Failed to accept connection." << std::endl;
-                continue;
+                if (isSocket)
+                    close(socketFd);
+                if (isUnix)
+                    unlink(FLAGS_unix_socket.c_str());
+                return -1;
             }
+            fcntl(httpFd, F_SETFL, fcntl(httpFd, F_GETFL) | O_NONBLOCK);
+        }
+
+        // All connections are served by one event loop on this thread. Workers hand finished requests back
+        // through doneList and wake the loop up with wakeFd.
+        int epollFd = epoll_create1(EPOLL_CLOEXEC);
+        int wakeFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        if (epollFd < 0 || wakeFd < 0)
+        {
+            std::cerr << "Failed to create event loop." << std::endl;
+            return -1;
+        }
+        const uint64_t listenId = 0, httpListenId = 1, wakeId = 2; // epoll ids, connections count up from 3
+        struct epoll_event event;
+        event.events = EPOLLIN;
+        if (isSocket)
+        {
+            event.data.u64 = listenId;
+            epoll_ctl(epollFd, EPOLL_CTL_ADD, socketFd, &event);
+        }
+        if (isHttp)
+        {
+            event.data.u64 = httpListenId;
+            epoll_ctl(epollFd, EPOLL_CTL_ADD, httpFd, &event);
+        }
+        event.data.u64 = wakeId;
+        epoll_ctl(epollFd, EPOLL_CTL_ADD, wakeFd, &event);
 
-            // Get actual client ip and port
-            char *clientIp = inet_ntoa(clientAddr.sin_addr);
-            int clientPort = ntohs(clientAddr.sin_port);
-            std::cerr << "Client connected. IP address: " << clientIp << ":" << clientPort << std::endl;
+        std::mutex doneMutex;              // Guards doneList
+        std::vector<Completion> doneList; // Requests finished by workers, not yet picked up by the loop
 
-            // Receive arbitrary length data
-            std::string strIn; // Data storage location
-            char buffer[1024]; // Buffer
-            int bytesRecv = 0;
-            while (true)
-            {
-                bytesRecv = recv(clientFd, buffer, sizeof(buffer), 0);
+        // Start OCR workers, this task's engine is used by the first one
+        std::unique_ptr<TaskPool> pool(new TaskPool(*this, FLAGS_workers, FLAGS_bulk_share));
+        std::cerr << "OCR workers: " << pool->size() << std::endl;
 
-                // No data received, client may have disconnected or connection error
-                if (bytesRecv <= 0)
-                    break;
+        // Largest request frame accepted with -framed
+        const uint32_t maxFrameLength = static_cast<uint32_t>(std::min<int64_t>(int64_t(FLAGS_max_frame_mb) << 20, UINT32_MAX));
 
-                // Append received data to end of storage
-                strIn.append(buffer, bytesRecv);
+        std::unordered_map<uint64_t, Connection> conns; // Open client connections by epoll id
+        uint64_t nextId = 3;
+        bool stopServer = false; // Set when a client sent the exit command
 
-                // Reach terminator, consider all data received
-                if (buffer[bytesRecv - 1] == '\0' || buffer[bytesRecv - 1] == '\n')
-                    break;
-            }
+        // Watch only what the connection can make progress on: its response while sending,
+        // nothing while its request is on a worker, otherwise the next request
+        auto watch = [&](uint64_t id, Connection &conn)
+        {
+            struct epoll_event ev;
+            ev.events = 0; // Hangups and errors are always reported
+            if (conn.outSent < conn.out.length())
+                ev.events |= EPOLLOUT;
+            else if (!conn.busy && !conn.peerClosed)
+                ev.events |= EPOLLIN;
+            ev.data.u64 = id;
+            epoll_ctl(epollFd, EPOLL_CTL_MOD, conn.fd, &ev);
+        };
+        auto closeConn = [&](uint64_t id)
+        {
+            Connection &conn = conns[id];
+            for (int fd : conn.fds)
+                close(fd);
+            close(conn.fd); // Also removes it from epoll
+            conns.erase(id);
+        };
 
-            if (bytesRecv == 0) // Client gracefully shutdown socket
+        // Start the next request of an idle connection if one is complete, otherwise wait for more bytes.
+        // Return false when the connection was closed.
+        auto dispatch = [&](uint64_t id, Connection &conn) -> bool
+        {
+            for (;;) // Requests answered without OCR go straight on with the next one, without recursion
             {
-                std::cerr << "Client has gracefully shutdown the socket." << std::endl;
+                std::string strIn;
+                uint32_t frameLength = 0;
+                int state = conn.http ? take_http_request(conn, strIn) : take_request(conn, strIn, maxFrameLength, frameLength);
+                int depth = pool->queued();
+                if (state == 1 && FLAGS_queue_size > 0 && depth >= FLAGS_queue_size)
+                { // Queue full, turn the request down right away so that the client can retry elsewhere
+                    std::cerr << "Request queue is full: " << depth << std::endl;
+                    for (int fd : conn.fds)
+                        close(fd);
+                    conn.fds.clear();
+                    std::string strOut = add_response_field(get_state_json(CODE_ERR_BUSY, MSG_ERR_BUSY(depth)), "queue_depth", std::to_string(depth));
+                    if (conn.http)
+                    {
+                        set_http_response(conn, 503, "application/json", strOut);
+                    }
+                    else
+                    {
+                        set_response(conn, strOut);
+                        // The rejected request decides, not the one the connection served before
+                        conn.keepAlive = is_keep_alive_request(strIn);
+                        conn.closing = !conn.keepAlive && !FLAGS_framed;
+                    }
+                    state = -3;
+                }
+                if (state == -3)
+                { // Answered without OCR: busy, HTTP protocol error, wrong route, or "100 Continue"
+                    if (!send_ready(conn) || (conn.outSent == conn.out.length() && conn.closing))
+                    {
+                        closeConn(id);
+                        return false;
+                    }
+                    if (conn.outSent == conn.out.length())
+                    { // Sent already, go on with a request the client may have sent behind it
+                        conn.out.clear();
+                        conn.outSent = 0;
+                        continue;
+                    }
+                    watch(id, conn);
+                    return true;
+                }
+                if (state == -2)
+                { // Frame too long, report it. The rest of the stream cannot be trusted, so close afterwards
+                    std::cerr << "Frame length exceeds limit: " << frameLength << std::endl;
+                    set_response(conn, get_state_json(CODE_ERR_FRAME_SIZE, MSG_ERR_FRAME_SIZE(frameLength)));
+                    conn.closing = true;
+                    if (!send_ready(conn) || conn.outSent == conn.out.length())
+                    {
+                        closeConn(id);
+                        return false;
+                    }
+                    watch(id, conn);
+                    return true;
+                }
+                if (state == 0)
+                {
+                    if (conn.peerClosed)
+                    { // Client gracefully shutdown socket
+                        std::cerr << "Client has gracefully shutdown the socket." << std::endl;
+                        closeConn(id);
+                        return false;
+                    }
+                    watch(id, conn);
+                    return true;
+                }
+                std::cerr << "Get string. Length: " << strIn.length() << std::endl;
+                if (conn.in.empty())
+                    std::string().swap(conn.in); // Do not hold on to the buffer of a large request while idle
+
+                // Hand the request to the next free worker, the loop goes on serving other connections meanwhile
+                conn.busy = true;
+                watch(id, conn);
+                std::shared_ptr<std::string> request = std::make_shared<std::string>(std::move(strIn));
+                std::vector<int> passedFds;
+                passedFds.swap(conn.fds);
+                TaskPool *workers = pool.get();
+                std::chrono::steady_clock::time_point received = std::chrono::steady_clock::now();
+                bool http = conn.http != nullptr;
+                pool->submit([id, request, passedFds, workers, received, http, &doneMutex, &doneList, wakeFd](Task &worker)
+                             {
+                    worker.set_state(); // Initialize state
+                    worker.t_fd = passedFds.empty() ? -1 : passedFds.front();
+                    worker.t_received = received; // Time spent in the queue counts against deadline_ms
+                    worker.t_stream_sink = [id, http, &worker, &doneMutex, &doneList, wakeFd](std::string record)
+                    {
+                        if (!http && !FLAGS_framed && worker.t_format != FORMAT_JSON)
+                            return; // Binary records need frames to be told apart
+                        Completion part;
+                        part.connId = id;
+                        part.out = worker.encode_response(std::move(record), true);
+                        part.format = worker.t_format;
+                        part.partial = true;
+                        {
+                            std::lock_guard<std::mutex> lock(doneMutex);
+                            doneList.push_back(std::move(part));
+                        }
+                        uint64_t one = 1;
+                        ssize_t ignored = write(wakeFd, &one, sizeof(one));
+                        (void)ignored;
+                    };
+                    Completion done;
+                    done.connId = id;
+                    try
+                    {
+                        done.out = worker.run_ocr(*request);
+                        // Report the load, so that a load balancer can shed requests before the queue is full
+                        done.out = worker.add_response_field(std::move(done.out), "queue_depth", std::to_string(workers->queued()));
+                        // HTTP, frames and connections closed after the response all delimit binary responses
+                        done.out = worker.encode_response(std::move(done.out), http || FLAGS_framed || !worker.t_keep_alive);
+                    }
+                    catch (const std::exception &e)
+                    { // Answer anyway, otherwise the connection waits for this response forever
+                        std::cerr << "OCR failed: " << e.what() << std::endl;
+                        worker.t_format = FORMAT_JSON;
+                        done.out = worker.get_state_json(CODE_ERR_OCR_FAILED, MSG_ERR_OCR_FAILED(e.what()));
+                    }
+                    catch (...)
+                    {
+                        std::cerr << "OCR failed." << std::endl;
+                        worker.t_format = FORMAT_JSON;
+                        done.out = worker.get_state_json(CODE_ERR_OCR_FAILED, MSG_ERR_OCR_FAILED("unknown error"));
+                    }
+                    done.format = worker.t_format;
+                    worker.t_stream_sink = nullptr;
+                    worker.t_fd = -1;
+                    for (int fd : passedFds) // Descriptors of this request are no longer needed
+                        close(fd);
+                    done.exit = worker.is_exit;
+                    done.keepAlive = worker.t_keep_alive;
+                    worker.is_exit = false;
+                    bool workerExit = done.exit;
+                    {
+                        std::lock_guard<std::mutex> lock(doneMutex);
+                        doneList.push_back(std::move(done));
+                    }
+                    uint64_t one = 1;
+                    ssize_t ignored = write(wakeFd, &one, sizeof(one));
+                    (void)ignored;
+                    // Check, cleanup memory
+                    if (!workerExit)
+                        worker.memory_check_cleanup(); },
+                             Task::is_bulk_request(*request));
+                return true;
             }
-            else if (bytesRecv < 0) // Connection error
+        };
+
+        // After the response is out, close the connection or go on with its next request
+        auto finishResponse = [&](uint64_t id, Connection &conn)
+        {
+            conn.out.clear();
+            conn.outSent = 0;
+            // Framed and HTTP connections decide themselves, the frames already delimit requests
+            if (conn.closing || (!conn.keepAlive && !FLAGS_framed && !conn.http))
+                closeConn(id);
+            else
+                dispatch(id, conn); // The client may already have sent the next request
+        };
+
+        const int sweepMs = 1000; // Idle connections are checked about once per second
+        auto lastSweep = std::chrono::steady_clock::now();
+        std::vector<struct epoll_event> events(256);
+        while (!stopServer)
+        {
+            int count = epoll_wait(epollFd, events.data(), static_cast<int>(events.size()), sweepMs);
+            if (count < 0 && errno != EINTR)
             {
-                std::cerr << "Failed to receive data, error code: " << errno << std::endl;
-                close(clientFd);
-                continue;
+                std::cerr << "Event loop failed, error code: " << errno << std::endl;
+                break;
             }
-            std::cerr << "Get string. Length: " << strIn.length() << std::endl;
-
-            // =============== OCR start ===============
-            set_state(); // Initialize state
-            // Get ocr result
-            std::string strOut = run_ocr(strIn);
-            // Received exit command, close connection, exit main loop, end server
-            if (is_exit)
+            for (int i = 0; i < count; i++)
             {
-                close(clientFd);
-                break;
+                uint64_t id = events[i].data.u64;
+                uint32_t flags = events[i].events;
+                if (id == listenId || id == httpListenId)
+                {
+                    // Accept all pending connection requests
+                    bool http = id == httpListenId;
+                    bool unixClient = isUnix && !http;
+                    while (true)
+                    {
+                        struct sockaddr_in clientAddr;
+                        socklen_t clientAddrLen = sizeof(clientAddr);
+                        int clientFd = accept4(http ? httpFd : socketFd, unixClient ? nullptr : (sockaddr *)&clientAddr, unixClient ? nullptr : &clientAddrLen, SOCK_NONBLOCK | SOCK_CLOEXEC);
+                        if (clientFd == INVALID_SOCKET)
+                        {
+                            if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)
+                                std::cerr << "Failed to accept connection." << std::endl;
+                            if (errno == EINTR)
+                                continue;
+                            break;
+                        }
+                        // Get actual client ip and port
+                        if (unixClient)
+                        {
+                            std::cerr << "Client connected. Unix socket: " << FLAGS_unix_socket << std::endl;
+                        }
+                        else
+                        {
+                            char *clientIp = inet_ntoa(clientAddr.sin_addr);
+                            int clientPort = ntohs(clientAddr.sin_port);
+                            std::cerr << "Client connected. IP address: " << clientIp << ":" << clientPort << std::endl;
+                        }
+                        uint64_t connId = nextId++;
+                        conns[connId].fd = clientFd;
+                        if (http)
+                            conns[connId].http.reset(new HttpParser(maxFrameLength));
+                        struct epoll_event ev;
+                        ev.events = EPOLLIN;
+                        ev.data.u64 = connId;
+                        epoll_ctl(epollFd, EPOLL_CTL_ADD, clientFd, &ev);
+                    }
+                    continue;
+                }
+                if (id == wakeId)
+                {
+                    uint64_t value;
+                    ssize_t ignored = read(wakeFd, &value, sizeof(value));
+                    (void)ignored;
+                    std::vector<Completion> finished;
+                    {
+                        std::lock_guard<std::mutex> lock(doneMutex);
+                        finished.swap(doneList);
+                    }
+                    for (auto &done : finished)
+                    {
+                        // Received exit command, stop accepting and end server
+                        if (done.exit)
+                            stopServer = true;
+                        auto it = conns.find(done.connId);
+                        if (stopServer || it == conns.end())
+                            continue;
+                        Connection &conn = it->second;
+                        if (done.partial)
+                        { // Streamed record, the request goes on. HTTP/1.0 clients only get the final response
+                            if (conn.closing || (conn.http && !conn.httpChunked))
+                                continue;
+                            add_stream_record(conn, done.out, done.format, Task::format_content_type(done.format));
+                            if (!send_ready(conn))
+                            {
+                                std::cerr << "Failed to send data." << std::endl;
+                                conn.closing = true; // Drop the response when it arrives
+                                epoll_ctl(epollFd, EPOLL_CTL_DEL, conn.fd, nullptr);
+                                continue;
+                            }
+                            watch(done.connId, conn);
+                            continue;
+                        }
+                        conn.busy = false;
+                        if (conn.closing)
+                        { // Connection broke while its request was running
+                            closeConn(done.connId);
+                            continue;
+                        }
+                        if (done.format == FORMAT_JSON)
+                            std::cerr << done.out << std::endl;
+                        else
+                            std::cerr << "Binary response. Length: " << done.out.length() << std::endl;
+                        if (conn.http && conn.httpStreaming)
+                        { // The final response is the last record, then the body ends
+                            add_stream_record(conn, done.out, done.format, Task::format_content_type(done.format));
+                            http_chunk(conn.out, nullptr, 0);
+                            conn.httpStreaming = false;
+                            conn.closing = !conn.keepAlive;
+                        }
+                        else if (conn.http)
+                        { // Keep-alive of HTTP connections follows the HTTP headers
+                            set_http_response(conn, 200, Task::format_content_type(done.format), done.out);
+                        }
+                        else
+                        {
+                            conn.keepAlive = done.keepAlive;
+                            set_response(conn, done.out);
+                        }
+                        if (!send_ready(conn))
+                        {
+                            std::cerr << "Failed to send data." << std::endl;
+                            closeConn(done.connId);
+                        }
+                        else if (conn.outSent == conn.out.length())
+                            finishResponse(done.connId, conn);
+                        else
+                            watch(done.connId, conn); // Socket buffer full, send the rest when it drains
+                    }
+                    continue;
+                }
+
+                auto it = conns.find(id);
+                if (it == conns.end())
+                    continue;
+                Connection &conn = it->second;
+                if (flags & EPOLLOUT)
+                {
+                    if (!send_ready(conn))
+                    {
+                        std::cerr << "Failed to send data." << std::endl;
+                        closeConn(id);
+                        continue;
+                    }
+                    if (conn.outSent == conn.out.length())
+                    {
+                        if (conn.busy)
+                        { // Streamed records are out, the request still runs
+                            conn.out.clear();
+                            conn.outSent = 0;
+                            watch(id, conn);
+                        }
+                        else
+                        {
+                            finishResponse(id, conn);
+                        }
+                    }
+                    continue;
+                }
+                if (conn.busy)
+                { // Hangup while the request runs, drop its result when it arrives
+                    if (flags & (EPOLLHUP | EPOLLERR))
+                    {
+                        conn.closing = true;
+                        epoll_ctl(epollFd, EPOLL_CTL_DEL, conn.fd, nullptr);
+                    }
+                    continue;
+                }
+                if (!recv_ready(conn))
+                {
+                    std::cerr << "Failed to receive data, error code: " << errno << std::endl;
+                    closeConn(id);
+                    continue;
+                }
+                dispatch(id, conn);
             }
-            // =============== OCR end ===============
 
-            // Send data
-            std::cerr << strOut << std::endl;
-            int bytesSent = send(clientFd, strOut.c_str(), strlen(strOut.c_str()), 0);
-            // No data sent | sent 0 bytes
-            if (bytesSent <= 0)
-                std::cerr << "Failed to send data." << std::endl;
+            // Close connections that stayed idle too long. Connections with a running request are never idle.
+            auto now = std::chrono::steady_clock::now();
+            if (now - lastSweep >= std::chrono::milliseconds(sweepMs))
+            {
+                lastSweep = now;
+                std::vector<uint64_t> idle;
+                for (auto &item : conns)
+                {
+                    if (!item.second.busy && now - item.second.lastActive >= std::chrono::seconds(FLAGS_keep_alive_timeout))
+                        idle.push_back(item.first);
+                }
+                for (uint64_t connId : idle)
+                {
+                    std::cerr << "Keep-alive connection idle timeout." << std::endl;
+                    closeConn(connId);
+                }
+            }
+        }
 
-            // Close connection
-            close(clientFd);
-            // Check, cleanup memory
-            Task::memory_check_cleanup();
+        // Close connections that are still open
+        for (auto &item : conns)
+        {
+            for (int fd : item.second.fds)
+                close(fd);
+            close(item.second.fd);
         }
+        conns.clear();
+        pool.reset(); // Finish requests still on the workers before their wakeup descriptor is closed
+        close(wakeFd);
+        close(epollFd);
 
         // Close socket
-        close(socketFd);
+        if (isSocket)
+            close(socketFd);
+        if (isHttp)
+            close(httpFd);
+        if (isUnix)
+            unlink(FLAGS_unix_socket.c_str());
 
         return 0;
     }
@@ -0,0 +1,132 @@
+#include <algorithm>
+
+#include "include/paddleocr.h"
+#include "include/task.h"
+#include "include/task_pool.h"
+
+namespace PaddleOCR
+{
+    TaskPool::TaskPool(Task &base, int num_workers, int bulk_share)
+        : bulk_share_(std::min(std::max(bulk_share, 0), 100))
+    {
+        if (num_workers < 1)
+            num_workers = 1;
+        // Worker 0 runs on the base task, no extra predictors needed
+        threads_.emplace_back(&TaskPool::worker_loop, this, std::ref(base));
+        for (int i = 1; i < num_workers; i++)
+        {
+            std::unique_ptr<Task> worker(new Task());
+            worker->clone_engine(base);
+            threads_.emplace_back(&TaskPool::worker_loop, this, std::ref(*worker));
+            clones_.push_back(std::move(worker));
+        }
+    }
+
+    TaskPool::~TaskPool()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stopping_ = true;
+        }
+        cond_.notify_all();
+        for (auto &t : threads_)
+            t.join();
+    }
+
+    void TaskPool::submit(Job job, bool bulk)
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            (bulk ? bulk_jobs_ : jobs_).push_back(std::move(job));
+        }
+        cond_.notify_one();
+    }
+
+    int TaskPool::size() const
+    {
+        return static_cast<int>(threads_.size());
+    }
+
+    int TaskPool::queued() const
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return static_cast<int>(jobs_.size() + bulk_jobs_.size());
+    }
+
+    bool TaskPool::bulk_turn()
+    {
+        bulk_credit_ += bulk_share_;
+        if (bulk_credit_ < 100)
+            return false;
+        bulk_credit_ -= 100;
+        return true;
+    }
+
+    void TaskPool::worker_loop(Task &worker)
+    {
+        Task guest; // Runs interactive jobs between the stages of a bulk job, on the engine borrowed from worker
+        while (true)
+        {
+            Job job;
+            bool bulk;
+            {
+                std::unique_lock<std::mutex> lock(mutex_);
+                cond_.wait(lock, [this]
+                           { return stopping_ || !jobs_.empty() || !bulk_jobs_.empty(); });
+                if (jobs_.empty() && bulk_jobs_.empty()) // Stopping and nothing left to do
+                    return;
+                bulk = jobs_.empty() || (!bulk_jobs_.empty() && bulk_turn());
+                std::deque<Job> &lane = bulk ? bulk_jobs_ : jobs_;
+                job = std::move(lane.front());
+                lane.pop_front();
+            }
+            if (bulk)
+            { // Interactive jobs arriving meanwhile need not wait for the whole bulk job
+                worker.ppocr->set_stage_hook([this, &worker, &guest]
+                                             { serve_interactive(worker, guest); });
+            }
+            run_job(job, worker);
+            if (bulk)
+            {
+                worker.ppocr->set_stage_hook(nullptr);
+            }
+        }
+    }
+
+    void TaskPool::serve_interactive(Task &worker, Task &guest)
+    {
+        while (true)
+        {
+            Job job;
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                if (jobs_.empty() || bulk_turn()) // The bulk job goes on with its next stage
+                    return;
+                job = std::move(jobs_.front());
+                jobs_.pop_front();
+            }
+            // Lend the engine to the guest task. The round state of the bulk request stays in worker,
+            // the engine state of its interrupted ocr() call is restored by PPOCR::next_stage().
+            guest.ppocr.swap(worker.ppocr);
+            run_job(job, guest);
+            guest.ppocr.swap(worker.ppocr);
+        }
+    }
+
+    void TaskPool::run_job(Job &job, Task &worker)
+    {
+        try
+        {
+            job(worker);
+        }
+        catch (const std::exception &e)
+        { // A failed job must not take the worker down with it
+            std::cerr << "Worker job failed: " << e.what() << std::endl;
+        }
+        catch (...)
+        {
+            std::cerr << "Worker job failed." << std::endl;
+        }
+    }
+
+} // namespace PaddleOCR
@@ -82,7 +82,7 @@ namespace PaddleOCR
     }
 
     // Replace cv::imread, read an image from pathW. pathW must be unicode wstring
-    cv::Mat Task::imread_wstr(std::wstring pathW, int flag)
+    cv::Mat Task::imread_wstr(std::wstring pathW, int flag, bool reduce)
     {
         std::string pathU8 = msg_wstr_2_ustr(pathW); // Convert back to utf-8 for error output.
         // ↑ Since this function may be reused by clipboard CF_UNICODETEXT, caller may only provide wstring, so convert once more.
@@ -100,12 +100,10 @@ namespace PaddleOCR
         // Read file into memory
         fseek(fp, 0, SEEK_END);                // Set file position of stream fp to SEEK_END end of file
         long sz = ftell(fp);                   // Get current file position of stream fp, i.e. total size (bytes)
-        char *buf = new char[sz];              // Store file byte content
+        std::shared_ptr<char> buf(new char[sz], std::default_delete<char[]>()); // Store file byte content, a reduced decode keeps it for the full resolution image
         fseek(fp, 0, SEEK_SET);                // Set file position of stream fp to SEEK_SET beginning of file
-        long n = fread(buf, 1, sz, fp);        // Read data from given stream fp to array pointed by buf, return total number of elements successfully read
-        cv::_InputArray arr(buf, sz);          // Convert to OpenCV array
-        cv::Mat img = cv::imdecode(arr, flag); // Decode memory data into cv::Mat data
-        delete[] buf;                          // Release buf space
+        long n = fread(buf.get(), 1, sz, fp);  // Read data from given stream fp to array pointed by buf, return total number of elements successfully read
+        cv::Mat img = imdecode_reducible(buf.get(), sz, flag, reduce, buf); // Decode memory data into cv::Mat data
         fclose(fp);                            // Close file
         if (img.empty())
         {
@@ -115,7 +113,7 @@ namespace PaddleOCR
     }
 
     // Replace cv imread, receive utf-8 string input, return Mat.
-    cv::Mat Task::imread_u8(std::string pathU8, int flag)
+    cv::Mat Task::imread_u8(std::string pathU8, int flag, bool reduce)
     {
 #if defined(_WIN32) && defined(ENABLE_CLIPBOARD)
         if (pathU8 == u8"clipboard")
@@ -134,7 +132,7 @@ namespace PaddleOCR
             set_state(CODE_ERR_PATH_CONV, MSG_ERR_PATH_CONV(pathU8)); // Report status: convert to wstring failed
             return cv::Mat();
         }
-        return imread_wstr(wpath);
+        return imread_wstr(wpath, flag, reduce);
     }
 
 #if defined(_WIN32) && defined(ENABLE_CLIPBOARD)
@@ -256,9 +254,60 @@ namespace PaddleOCR
     }
 #endif
 
+    // Read image from a named file mapping, such as one created by CreateFileMapping or Python's SharedMemory.
+    // desc holds name and offset (default 0), see imread_mapped for the rest.
+    cv::Mat Task::imread_shm(const nlohmann::json &desc)
+    {
+        std::string name = desc.at("name").get<std::string>();
+        t_path = name; // Set image path for output when no text
+        size_t offset = desc.value("offset", static_cast<size_t>(0));
+        HANDLE hMap = OpenFileMappingA(FILE_MAP_COPY, FALSE, name.c_str());
+        if (!hMap)
+        {
+            set_state(CODE_ERR_SHM_OPEN, MSG_ERR_SHM_OPEN(name));
+            return cv::Mat();
+        }
+        // View offset must be aligned to allocation granularity. Copy-on-write, raw pixels are used in place.
+        SYSTEM_INFO sysInfo;
+        GetSystemInfo(&sysInfo);
+        unsigned long long base = offset / sysInfo.dwAllocationGranularity * sysInfo.dwAllocationGranularity;
+        void *addr = MapViewOfFile(hMap, FILE_MAP_COPY, static_cast<DWORD>(base >> 32), static_cast<DWORD>(base & 0xFFFFFFFF), 0);
+        CloseHandle(hMap); // The view keeps the mapping alive
+        if (!addr)
+        {
+            set_state(CODE_ERR_SHM_MAP, MSG_ERR_SHM_MAP(name));
+            return cv::Mat();
+        }
+        t_mapping.reset(addr, [](void *p)
+                        { UnmapViewOfFile(p); });
+        MEMORY_BASIC_INFORMATION info;
+        VirtualQuery(addr, &info, sizeof(info));
+        if (offset - base >= info.RegionSize)
+        {
+            set_state(CODE_ERR_SHM_MAP, MSG_ERR_SHM_MAP(name));
+            return cv::Mat();
+        }
+        return imread_mapped(desc, static_cast<char *>(addr) + (offset - base), info.RegionSize - (offset - base));
+    }
+
     // Socket mode
     int Task::socket_mode()
     {
+        if (!FLAGS_unix_socket.empty())
+        {
+            std::cerr << "Unix domain socket mode is not supported on Windows." << std::endl;
+            return -1;
+        }
+        if (FLAGS_http_port >= 0 && FLAGS_port < 0)
+        {
+            std::cerr << "HTTP server mode is not supported on Windows." << std::endl;
+            return -1;
+        }
+        if (FLAGS_framed)
+        { // Replies would go out line delimited, which a framed client can not parse
+            std::cerr << "Framed socket mode is not supported on Windows." << std::endl;
+            return -1;
+        }
         // Initialize Winsock library
         WSADATA wsa_data; // Winsock structure
         if (WSAStartup(MAKEWORD(2, 2), &wsa_data) != 0)
@@ -367,19 +416,33 @@ namespace PaddleOCR
 
             // =============== OCR start ===============
             set_state(); // Initialize state
+            t_stream_sink = [this, client_fd](std::string record)
+            { // Streamed records end with a line break, the response ends with the connection. Binary ones cannot be told apart
+                if (t_format != FORMAT_JSON)
+                    return;
+                record.push_back('\n');
+                send(client_fd, record.data(), static_cast<int>(record.length()), 0);
+            };
             // Get ocr result
             std::string str_out = run_ocr(str_in);
+            t_stream_sink = nullptr;
             if (is_exit)
             { // Exit
                 // Close connection
                 closesocket(client_fd);
                 break;
             }
+            // Closing the connection ends the response, so binary formats need no frame
+            bool binary = t_format != FORMAT_JSON;
+            str_out = encode_response(std::move(str_out), true);
             // =============== OCR end ===============
 
             // Send data
-            std::cerr << str_out << std::endl;
-            int m = send(client_fd, str_out.c_str(), strlen(str_out.c_str()), 0);
+            if (binary)
+                std::cerr << "Binary response. Length: " << str_out.length() << std::endl;
+            else
+                std::cerr << str_out << std::endl;
+            int m = send(client_fd, str_out.data(), static_cast<int>(str_out.length()), 0);
             if (m <= 0)
             {
                 std::cerr << "Failed to send data." << std::endl;
@@ -125,14 +125,14 @@ namespace PaddleOCR
     {
         if (NULL == dir_name)
         {
-            std::cout << " dir_name is null ! " << std::endl;
+            std::cerr << " dir_name is null ! " << std::endl;
             return;
         }
         struct stat s;
         stat(dir_name, &s);
         if (!S_ISDIR(s.st_mode))
         {
-            std::cout << "dir_name is not a valid directory !" << std::endl;
+            std::cerr << "dir_name is not a valid directory !" << std::endl;
             all_inputs.push_back(dir_name);
             return;
         }
@@ -143,10 +143,10 @@ namespace PaddleOCR
             dir = opendir(dir_name);
             if (NULL == dir)
             {
-                std::cout << "Can not open dir " << dir_name << std::endl;
+                std::cerr << "Can not open dir " << dir_name << std::endl;
                 return;
             }
-            std::cout << "Successfully opened the dir !" << std::endl;
+            std::cerr << "Successfully opened the dir !" << std::endl;
             while ((filename = readdir(dir)) != NULL)
             {
                 if (strcmp(filename->d_name, ".") == 0 ||
@@ -1,5 +1,7 @@
 #include <gtest/gtest.h>
 #include "base64.h"
+#include "base64_fast.h"
+#include <cstdlib>
 #include <string>
 #include <vector>
 
@@ -109,4 +111,54 @@ TEST_F(Base64Test, InvalidInput) {
     std::string result = base64_decode(invalid);
     // Should handle gracefully (implementation dependent)
     EXPECT_TRUE(true);  // Just ensure it doesn't crash
-}
\ No newline at end of file
+}
+
+// base64_decode_into() against the reference base64_decode(), at every SIMD level the CPU supports
+static std::string decode_into(const std::string &encoded, Base64Simd simd, bool &ok) {
+    std::vector<unsigned char> out(base64_decoded_length(encoded.data(), encoded.size()));
+    ok = base64_decode_into(encoded.data(), encoded.size(), out.data(), simd);
+    return std::string(out.begin(), out.end());
+}
+
+TEST_F(Base64Test, DecodeIntoMatchesReference) {
+    srand(42);
+    for (int simd = BASE64_SCALAR; simd <= base64_simd_support(); ++simd) {
+        for (size_t n = 0; n < 300; ++n) {
+            std::string data;
+            for (size_t i = 0; i < n; ++i)
+                data.push_back(static_cast<char>(rand()));
+            for (bool url : {false, true}) {
+                std::string encoded = base64_encode(data, url);
+                bool ok = false;
+                std::string decoded = decode_into(encoded, static_cast<Base64Simd>(simd), ok);
+                EXPECT_TRUE(ok) << "simd " << simd << ", length " << n;
+                EXPECT_EQ(decoded, base64_decode(encoded)) << "simd " << simd << ", length " << n;
+
+                // Padding is optional
+                while (!encoded.empty() && (encoded.back() == '=' || encoded.back() == '.'))
+                    encoded.pop_back();
+                decoded = decode_into(encoded, static_cast<Base64Simd>(simd), ok);
+                EXPECT_TRUE(ok);
+                EXPECT_EQ(decoded, data);
+            }
+        }
+    }
+}
+
+TEST_F(Base64Test, DecodeIntoRejectsInvalidInput) {
+    std::string data(1000, 'x');
+    std::string encoded = base64_encode(data);
+    for (int simd = BASE64_SCALAR; simd <= base64_simd_support(); ++simd) {
+        // Invalid char at every position of the SIMD blocks and the scalar tail
+        for (size_t pos = 0; pos < encoded.size() - 2; pos += 7) {
+            std::string invalid = encoded;
+            invalid[pos] = '@';
+            bool ok = true;
+            decode_into(invalid, static_cast<Base64Simd>(simd), ok);
+            EXPECT_FALSE(ok) << "simd " << simd << ", position " << pos;
+        }
+        bool ok = true;
+        decode_into("QUJDR", static_cast<Base64Simd>(simd), ok); // Length % 4 == 1
+        EXPECT_FALSE(ok);
+    }
+}
@@ -0,0 +1,90 @@
+#include <gtest/gtest.h>
+#include "batch_io.h"
+#include "nlohmann/json.hpp"
+#include <sstream>
+
+using namespace PaddleOCR;
+
+TEST(BatchIoTest, ReadsManifestLines) {
+    std::istringstream in("a.jpg\r\n\r\nb c.png\n\nd.bmp");
+    std::vector<std::string> paths = read_manifest(in);
+    ASSERT_EQ(paths.size(), 3u);
+    EXPECT_EQ(paths[0], "a.jpg");
+    EXPECT_EQ(paths[1], "b c.png"); // Spaces are part of the path
+    EXPECT_EQ(paths[2], "d.bmp");   // Last line without a line break
+
+    std::istringstream empty("");
+    EXPECT_TRUE(read_manifest(empty).empty());
+}
+
+TEST(BatchIoTest, MatchesImageExtensions) {
+    EXPECT_TRUE(is_image_file("dir/a.jpg"));
+    EXPECT_TRUE(is_image_file("A.JPEG"));
+    EXPECT_TRUE(is_image_file("scan.Tiff"));
+    EXPECT_FALSE(is_image_file("notes.txt"));
+    EXPECT_FALSE(is_image_file("jpg"));
+    EXPECT_FALSE(is_image_file("a.jpg.bak"));
+}
+
+TEST(BatchIoTest, WritesInInputOrder) {
+    std::ostringstream out;
+    BatchWriter writer(out, true);
+    writer.write(2, "c");
+    writer.write(1, "b");
+    EXPECT_EQ(out.str(), "");
+    EXPECT_EQ(writer.held(), 2u);
+    writer.write(0, "a");
+    EXPECT_EQ(out.str(), "a\nb\nc\n");
+    EXPECT_EQ(writer.held(), 0u);
+    writer.finish();
+    EXPECT_EQ(out.str(), "a\nb\nc\n");
+}
+
+TEST(BatchIoTest, WritesInCompletionOrder) {
+    std::ostringstream out;
+    BatchWriter writer(out, false);
+    writer.write(2, "c");
+    writer.write(0, "a");
+    EXPECT_EQ(out.str(), "c\na\n");
+    EXPECT_EQ(writer.held(), 0u);
+}
+
+TEST(BatchIoTest, ErrorLineAdvancesInputOrder) {
+    std::ostringstream out;
+    BatchWriter writer(out, true);
+    writer.write(1, "b");
+    writer.write(2, "c");
+    writer.write(0, batch_error_line(502, "OCR failed: boom", "a.jpg", false));
+    EXPECT_EQ(writer.held(), 0u);
+
+    std::istringstream lines(out.str());
+    std::string line;
+    ASSERT_TRUE(std::getline(lines, line));
+    nlohmann::json j = nlohmann::json::parse(line);
+    EXPECT_EQ(j["code"], 502);
+    EXPECT_EQ(j["data"], "OCR failed: boom");
+    EXPECT_EQ(j["path"], "a.jpg");
+    ASSERT_TRUE(std::getline(lines, line));
+    EXPECT_EQ(line, "b");
+    ASSERT_TRUE(std::getline(lines, line));
+    EXPECT_EQ(line, "c");
+}
+
+TEST(BatchIoTest, FinishWritesLinesAfterAGap) {
+    std::ostringstream out;
+    BatchWriter writer(out, true);
+    writer.write(0, "a");
+    writer.write(2, "c");
+    EXPECT_EQ(writer.held(), 1u);
+    writer.finish();
+    EXPECT_EQ(out.str(), "a\nc\n");
+    EXPECT_EQ(writer.held(), 0u);
+}
+
+TEST(BatchIoTest, ReplacesInvalidUtf8InPaths) {
+    std::string path = "bad\xff.jpg";
+    nlohmann::json j = nlohmann::json::parse(batch_error_line(201, "read failed", path, false));
+    EXPECT_EQ(j["path"], "bad\xEF\xBF\xBD.jpg");
+    EXPECT_EQ(batch_path_json(path, true), "\"bad\\ufffd.jpg\"");
+    EXPECT_EQ(batch_path_json("a.jpg", true), "\"a.jpg\"");
+}
@@ -0,0 +1,92 @@
+#include <gtest/gtest.h>
+#include "http.h"
+#include <string>
+
+using PaddleOCR::HttpParser;
+using PaddleOCR::HttpRequest;
+
+TEST(HttpParserTest, ContentLengthBodyArrivingInPieces) {
+    HttpParser parser(1024);
+    HttpRequest request;
+    std::string buffer = "POST /ocr?x=1 HTTP/1.1\r\nHost: a\r\nContent-Type: Application/JSON; charset=utf-8\r\n";
+    EXPECT_EQ(parser.parse(buffer, request), HttpParser::HTTP_INCOMPLETE);
+    buffer += "Content-Length: 5\r\n\r\nab";
+    EXPECT_EQ(parser.parse(buffer, request), HttpParser::HTTP_INCOMPLETE);
+    buffer += "cdePOST";
+    ASSERT_EQ(parser.parse(buffer, request), HttpParser::HTTP_COMPLETE);
+    EXPECT_EQ(request.method, "POST");
+    EXPECT_EQ(request.path, "/ocr");
+    EXPECT_EQ(request.content_type, "application/json");
+    EXPECT_EQ(request.body, "abcde");
+    EXPECT_TRUE(request.keep_alive);
+    EXPECT_EQ(buffer, "POST"); // Next pipelined request stays in the buffer
+}
+
+TEST(HttpParserTest, ChunkedBody) {
+    HttpParser parser(1024);
+    HttpRequest request;
+    std::string buffer = "POST /ocr HTTP/1.1\r\nTransfer-Encoding: chunked\r\n\r\n3\r\nabc\r\n";
+    EXPECT_EQ(parser.parse(buffer, request), HttpParser::HTTP_INCOMPLETE);
+    buffer += "a;ext=1\r\n0123456789\r\n0\r\n";
+    EXPECT_EQ(parser.parse(buffer, request), HttpParser::HTTP_INCOMPLETE);
+    buffer += "\r\n";
+    ASSERT_EQ(parser.parse(buffer, request), HttpParser::HTTP_COMPLETE);
+    EXPECT_EQ(request.body, "abc0123456789");
+    EXPECT_TRUE(buffer.empty());
+}
+
+TEST(HttpParserTest, ConnectionHandling) {
+    HttpParser parser(1024);
+    HttpRequest request;
+    std::string buffer = "POST /ocr HTTP/1.0\r\nContent-Length: 0\r\n\r\n";
+    ASSERT_EQ(parser.parse(buffer, request), HttpParser::HTTP_COMPLETE);
+    EXPECT_FALSE(request.keep_alive);
+    EXPECT_FALSE(request.http_1_1);
+    buffer = "POST /ocr HTTP/1.1\r\nConnection: close\r\n\r\n";
+    ASSERT_EQ(parser.parse(buffer, request), HttpParser::HTTP_COMPLETE);
+    EXPECT_FALSE(request.keep_alive);
+    EXPECT_TRUE(request.body.empty());
+}
+
+TEST(HttpParserTest, ExpectContinueAnsweredOnce) {
+    HttpParser parser(1024);
+    HttpRequest request;
+    std::string buffer = "POST /ocr HTTP/1.1\r\nContent-Length: 3\r\nExpect: 100-continue\r\n\r\n";
+    EXPECT_EQ(parser.parse(buffer, request), HttpParser::HTTP_INCOMPLETE);
+    EXPECT_TRUE(parser.expects_continue());
+    EXPECT_FALSE(parser.expects_continue());
+    buffer += "abc";
+    EXPECT_EQ(parser.parse(buffer, request), HttpParser::HTTP_COMPLETE);
+}
+
+TEST(HttpParserTest, RejectsInvalidRequests) {
+    HttpRequest request;
+    std::string buffer = "POST /ocr HTTP/1.1\r\nContent-Length: 2000\r\n\r\n";
+    HttpParser parser(1024);
+    EXPECT_EQ(parser.parse(buffer, request), HttpParser::HTTP_FAILED);
+    EXPECT_EQ(parser.error_status(), 413);
+
+    buffer = "POST /ocr HTTP/1.1\r\nContent-Length: x\r\n\r\n";
+    HttpParser parser2(1024);
+    EXPECT_EQ(parser2.parse(buffer, request), HttpParser::HTTP_FAILED);
+    EXPECT_EQ(parser2.error_status(), 400);
+
+    buffer = "garbage\r\n\r\n";
+    HttpParser parser3(1024);
+    EXPECT_EQ(parser3.parse(buffer, request), HttpParser::HTTP_FAILED);
+
+    buffer = "POST /ocr HTTP/1.1\r\nTransfer-Encoding: chunked\r\n\r\n800\r\n";
+    HttpParser parser4(1024);
+    EXPECT_EQ(parser4.parse(buffer, request), HttpParser::HTTP_FAILED);
+    EXPECT_EQ(parser4.error_status(), 413);
+}
+
+TEST(HttpResponseTest, ChunkedResponse) {
+    std::string out = PaddleOCR::http_head(200, "application/json", true, true);
+    EXPECT_NE(out.find("Transfer-Encoding: chunked\r\n"), std::string::npos);
+    EXPECT_EQ(out.substr(out.length() - 4), "\r\n\r\n");
+    out.clear();
+    PaddleOCR::http_chunk(out, "0123456789abcdef!", 17);
+    PaddleOCR::http_chunk(out, nullptr, 0);
+    EXPECT_EQ(out, "11\r\n0123456789abcdef!\r\n0\r\n\r\n");
+}
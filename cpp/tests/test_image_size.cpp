@@ -0,0 +1,71 @@
+#include <gtest/gtest.h>
+#include "image_size.h"
+#include <limits>
+#include <vector>
+
+using PaddleOCR::jpeg_size;
+using PaddleOCR::reduced_decode_scale;
+using PaddleOCR::raw_image_bytes;
+
+// JPEG headers up to the frame header: SOI, an APP0 segment, then SOF (baseline or progressive)
+static std::vector<unsigned char> jpeg_header(int width, int height, unsigned char sof = 0xC0) {
+    std::vector<unsigned char> data = {0xFF, 0xD8,
+                                       0xFF, 0xE0, 0x00, 0x10, 'J', 'F', 'I', 'F', 0, 1, 1, 0, 0, 1, 0, 1, 0, 0,
+                                       0xFF, 0xC4, 0x00, 0x03, 0x00, // A table before the frame
+                                       0xFF, sof, 0x00, 0x11, 0x08,
+                                       static_cast<unsigned char>(height >> 8), static_cast<unsigned char>(height),
+                                       static_cast<unsigned char>(width >> 8), static_cast<unsigned char>(width),
+                                       0x03, 1, 0x22, 0, 2, 0x11, 1, 3, 0x11, 1};
+    return data;
+}
+
+TEST(ImageSizeTest, ReadsJpegFrameHeader) {
+    int width = 0, height = 0;
+    std::vector<unsigned char> data = jpeg_header(6000, 4000);
+    ASSERT_TRUE(jpeg_size(data.data(), data.size(), width, height));
+    EXPECT_EQ(width, 6000);
+    EXPECT_EQ(height, 4000);
+
+    data = jpeg_header(640, 65535, 0xC2);
+    ASSERT_TRUE(jpeg_size(data.data(), data.size(), width, height));
+    EXPECT_EQ(width, 640);
+    EXPECT_EQ(height, 65535);
+}
+
+TEST(ImageSizeTest, RejectsOtherAndCutData) {
+    int width = 0, height = 0;
+    const unsigned char png[] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n'};
+    EXPECT_FALSE(jpeg_size(png, sizeof(png), width, height));
+    std::vector<unsigned char> data = jpeg_header(6000, 4000);
+    EXPECT_FALSE(jpeg_size(data.data(), 30, width, height)); // Cut inside the frame header
+    EXPECT_FALSE(jpeg_size(data.data(), 2, width, height));
+    data = jpeg_header(0, 4000);
+    EXPECT_FALSE(jpeg_size(data.data(), data.size(), width, height)); // Height defined later (DNL) is not supported
+}
+
+TEST(ImageSizeTest, ScaleKeepsLimitSide) {
+    EXPECT_EQ(reduced_decode_scale(8000, 6000, "max", 960, 20), 8);
+    EXPECT_EQ(reduced_decode_scale(6000, 4000, "max", 960, 20), 4);
+    EXPECT_EQ(reduced_decode_scale(6000, 4000, "max", 2000, 20), 2);
+    EXPECT_EQ(reduced_decode_scale(6000, 4000, "min", 960, 20), 1); // Detection keeps large images as they are
+    EXPECT_EQ(reduced_decode_scale(6000, 4000, "max", 4000, 20), 1);
+    EXPECT_EQ(reduced_decode_scale(4000, 3000, "max", 960, 20), 1); // Below the size threshold
+    EXPECT_EQ(reduced_decode_scale(8000, 6000, "max", 960, 0), 1);  // Disabled
+}
+
+TEST(ImageSizeTest, RawImageBytes) {
+    EXPECT_EQ(raw_image_bytes(300, 100, 300), 30000u);
+    EXPECT_EQ(raw_image_bytes(300, 100, 320), 320u * 99 + 300); // No padding after the last row
+    EXPECT_EQ(raw_image_bytes(300, 1, 1000000), 300u);          // A single row ignores the stride
+    EXPECT_EQ(raw_image_bytes(300, 0, 300), 0u);
+}
+
+TEST(ImageSizeTest, RawImageBytesSaturatesOnHugeStride) {
+    const size_t max = std::numeric_limits<size_t>::max();
+    // stride * (height - 1) wraps around to a small number without the check
+    size_t stride = max / 2 + 2;
+    EXPECT_EQ(raw_image_bytes(300, 3, stride), max);
+    EXPECT_EQ(raw_image_bytes(300, 2, max), max);
+    EXPECT_EQ(raw_image_bytes(4, 2, max - 5), max - 1); // Just fits
+    EXPECT_EQ(raw_image_bytes(4, 2, max - 3), max);
+}
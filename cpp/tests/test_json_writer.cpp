@@ -0,0 +1,151 @@
+#include <gtest/gtest.h>
+#include "json_writer.h"
+#include "nlohmann/json.hpp"
+#include <cmath>
+#include <stdexcept>
+#include <string>
+
+using PaddleOCR::json_append_float;
+using PaddleOCR::json_append_int;
+using PaddleOCR::json_append_string;
+using namespace PaddleOCR;
+
+static std::string write_string(const std::string &str, bool ensure_ascii) {
+    std::string out;
+    json_append_string(out, str, ensure_ascii);
+    return out;
+}
+
+TEST(JsonWriterTest, StringsMatchNlohmannDump) {
+    const std::string samples[] = {
+        "",
+        "plain text",
+        "quote \" backslash \\ slash /",
+        std::string("controls \b\t\n\f\r \x01\x1f \x7f end"),
+        std::string("nul \0 inside", 12),
+        "\xe4\xb8\xad\xe6\x96\x87 \xc3\xa9",       // CJK and Latin-1
+        "emoji \xf0\x9f\x98\x80 \xf4\x8f\xbf\xbf", // Outside the BMP, surrogate pairs with ensure_ascii
+        "\xef\xbf\xbf \xe0\xa0\x80",
+    };
+    for (const std::string &sample : samples) {
+        for (bool ensure_ascii : {true, false}) {
+            EXPECT_EQ(write_string(sample, ensure_ascii), nlohmann::json(sample).dump(-1, ' ', ensure_ascii))
+                << "ensure_ascii=" << ensure_ascii;
+        }
+    }
+}
+
+TEST(JsonWriterTest, InvalidUtf8Throws) {
+    const std::string samples[] = {
+        "\xff",
+        "\xc0\xaf",         // Overlong
+        "\xed\xa0\x80",     // Surrogate
+        "\xf4\x90\x80\x80", // Above U+10FFFF
+        "cut \xe4\xb8",     // Truncated
+        "\x80 stray",
+    };
+    for (const std::string &sample : samples) {
+        for (bool ensure_ascii : {true, false}) {
+            EXPECT_THROW(write_string(sample, ensure_ascii), std::invalid_argument);
+            EXPECT_THROW(nlohmann::json(sample).dump(-1, ' ', ensure_ascii), nlohmann::json::type_error);
+        }
+    }
+}
+
+TEST(JsonWriterTest, NumbersMatchNlohmannDump) {
+    for (long long value : {0LL, 7LL, -1LL, 1920LL, -2147483648LL, 9223372036854775807LL}) {
+        std::string out;
+        json_append_int(out, value);
+        EXPECT_EQ(out, nlohmann::json(value).dump());
+    }
+    for (float value : {0.0f, -0.0f, 1.0f, 0.5f, 0.99871826f, 1e-7f, 123456.78f}) {
+        std::string out;
+        json_append_float(out, value);
+        EXPECT_EQ(out, nlohmann::json(value).dump());
+    }
+    std::string out;
+    json_append_float(out, NAN);
+    json_append_float(out, INFINITY);
+    EXPECT_EQ(out, "nullnull");
+}
+
+// nlohmann's MessagePack or CBOR encoding of a value, as a string
+static std::string nlohmann_bin(const nlohmann::json &j, bool cbor) {
+    std::vector<uint8_t> bytes = cbor ? nlohmann::json::to_cbor(j) : nlohmann::json::to_msgpack(j);
+    return std::string(bytes.begin(), bytes.end());
+}
+
+TEST(JsonWriterTest, BinaryValuesMatchNlohmann) {
+    for (bool cbor : {false, true}) {
+        for (long long value : {0LL, 23LL, 24LL, 127LL, 128LL, 255LL, 256LL, 65536LL, 4294967296LL, -1LL, -24LL,
+                                -25LL, -32LL, -33LL, -128LL, -129LL, -32769LL, -2147483649LL,
+                                9223372036854775807LL, -9223372036854775807LL - 1}) {
+            std::string out;
+            bin_append_int(out, cbor, value);
+            EXPECT_EQ(out, nlohmann_bin(value, cbor)) << value << " cbor=" << cbor;
+        }
+        for (double value : {0.0, 0.5, 0.99871826171875, static_cast<double>(0.9987f), 0.1, 1e300, -2.5}) {
+            std::string out;
+            bin_append_float(out, cbor, value);
+            EXPECT_EQ(out, nlohmann_bin(value, cbor)) << value << " cbor=" << cbor;
+        }
+        for (size_t size : {0, 5, 23, 24, 31, 32, 255, 256, 70000}) {
+            std::string str(size, 'x'), out;
+            bin_append_string(out, cbor, str);
+            EXPECT_EQ(out, nlohmann_bin(str, cbor)) << size << " cbor=" << cbor;
+        }
+        std::string out;
+        bin_append_string(out, cbor, "\xe4\xb8\xad\xe6\x96\x87");
+        EXPECT_EQ(out, nlohmann_bin("\xe4\xb8\xad\xe6\x96\x87", cbor));
+        EXPECT_THROW(bin_append_string(out, cbor, "cut \xe4\xb8"), std::invalid_argument);
+        out.clear();
+        bin_append_float(out, cbor, NAN);
+        EXPECT_EQ(out, nlohmann_bin(nullptr, cbor));
+    }
+}
+
+TEST(JsonWriterTest, BinaryContainersMatchNlohmann) {
+    for (bool cbor : {false, true}) {
+        for (size_t size : {0, 3, 15, 16, 24, 70000}) {
+            nlohmann::json array = nlohmann::json::array();
+            std::string out;
+            bin_append_array(out, cbor, size);
+            for (size_t i = 0; i < size; i++) {
+                array.push_back(static_cast<int>(i % 3));
+                bin_append_int(out, cbor, static_cast<int>(i % 3));
+            }
+            EXPECT_EQ(out, nlohmann_bin(array, cbor)) << size << " cbor=" << cbor;
+        }
+        // Keys in the order nlohmann sorts them
+        nlohmann::json map = {{"box", {1, -1}}, {"score", 0.5}, {"text", "a"}};
+        std::string out;
+        bin_append_map(out, cbor, 3);
+        bin_append_string(out, cbor, "box");
+        bin_append_array(out, cbor, 2);
+        bin_append_int(out, cbor, 1);
+        bin_append_int(out, cbor, -1);
+        bin_append_string(out, cbor, "score");
+        bin_append_float(out, cbor, 0.5);
+        bin_append_string(out, cbor, "text");
+        bin_append_string(out, cbor, "a");
+        EXPECT_EQ(out, nlohmann_bin(map, cbor));
+    }
+}
+
+TEST(JsonWriterTest, BinaryResponseTakesMoreMembers) {
+    for (bool cbor : {false, true}) {
+        std::string out;
+        bin_begin_response(out, cbor, 1);
+        bin_append_string(out, cbor, "code");
+        bin_append_int(out, cbor, 100);
+        EXPECT_TRUE(bin_is_response(out));
+        bin_grow_response(out);
+        bin_append_string(out, cbor, "id");
+        bin_append_string(out, cbor, "r1");
+        std::vector<uint8_t> bytes(out.begin(), out.end());
+        nlohmann::json j = cbor ? nlohmann::json::from_cbor(bytes) : nlohmann::json::from_msgpack(bytes);
+        EXPECT_EQ(j, (nlohmann::json{{"code", 100}, {"id", "r1"}}));
+    }
+    EXPECT_FALSE(bin_is_response("{\"code\":100}"));
+    EXPECT_FALSE(bin_is_response(""));
+}
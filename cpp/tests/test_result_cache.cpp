@@ -0,0 +1,97 @@
+#include <gtest/gtest.h>
+#include "result_cache.h"
+#include <string>
+#include <thread>
+
+using PaddleOCR::ResultCache;
+
+TEST(ResultCacheTest, MissThenHit) {
+    ResultCache cache(1 << 20);
+    std::string result;
+    bool owner;
+    EXPECT_FALSE(cache.acquire("a", result, owner));
+    ASSERT_TRUE(owner);
+    std::string computed = "{\"code\":100}";
+    cache.finish("a", &computed);
+    EXPECT_TRUE(cache.acquire("a", result, owner));
+    EXPECT_FALSE(owner);
+    EXPECT_EQ(result, computed);
+}
+
+TEST(ResultCacheTest, DisabledCacheNeverHits) {
+    ResultCache cache(0);
+    std::string result;
+    bool owner;
+    EXPECT_FALSE(cache.enabled());
+    EXPECT_FALSE(cache.acquire("a", result, owner));
+    EXPECT_FALSE(owner);
+}
+
+TEST(ResultCacheTest, EvictsLeastRecentlyUsed) {
+    std::string big(400, 'x');
+    ResultCache cache(1000); // Room for two entries
+    std::string result;
+    bool owner;
+    for (const char *key : {"a", "b"}) {
+        cache.acquire(key, result, owner);
+        cache.finish(key, &big);
+    }
+    EXPECT_TRUE(cache.acquire("a", result, owner)); // "b" is now the least recently used
+    cache.acquire("c", result, owner);
+    cache.finish("c", &big);
+    EXPECT_LE(cache.bytes(), 1000u);
+    EXPECT_TRUE(cache.acquire("a", result, owner));
+    EXPECT_FALSE(cache.acquire("b", result, owner));
+    cache.finish("b", nullptr);
+}
+
+TEST(ResultCacheTest, ConcurrentRequestWaitsForOwner) {
+    ResultCache cache(1 << 20);
+    std::string result;
+    bool owner;
+    ASSERT_FALSE(cache.acquire("a", result, owner));
+    ASSERT_TRUE(owner);
+    std::string waited;
+    bool waiterHit = false, waiterOwner = true;
+    std::thread waiter([&] { waiterHit = cache.acquire("a", waited, waiterOwner); });
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    std::string computed = "done";
+    cache.finish("a", &computed);
+    waiter.join();
+    EXPECT_TRUE(waiterHit);
+    EXPECT_FALSE(waiterOwner);
+    EXPECT_EQ(waited, "done");
+}
+
+TEST(ResultCacheTest, OwnerThreadDoesNotWaitForItself) {
+    ResultCache cache(1 << 20);
+    std::string result;
+    bool owner;
+    ASSERT_FALSE(cache.acquire("a", result, owner));
+    // The same key again on this thread, e.g. a request run between the stages of the first
+    EXPECT_FALSE(cache.acquire("a", result, owner));
+    EXPECT_FALSE(owner);
+    cache.finish("a", nullptr);
+    EXPECT_FALSE(cache.acquire("a", result, owner)); // Not cached, computed again
+    EXPECT_TRUE(owner);
+}
+
+TEST(ResultCacheTest, WaiterGivesUpAtItsDeadline) {
+    ResultCache cache(1 << 20);
+    std::string result;
+    bool owner;
+    ASSERT_FALSE(cache.acquire("a", result, owner));
+    std::string waited;
+    bool waiterHit = true, waiterOwner = true;
+    std::thread waiter([&] {
+        auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(20);
+        waiterHit = cache.acquire("a", waited, waiterOwner, deadline);
+    });
+    waiter.join(); // Returns while the owner is still computing
+    EXPECT_FALSE(waiterHit);
+    EXPECT_FALSE(waiterOwner); // A plain miss, the waiter computes without caching
+    std::string computed = "done";
+    cache.finish("a", &computed);
+    EXPECT_TRUE(cache.acquire("a", result, owner));
+    EXPECT_EQ(result, "done");
+}
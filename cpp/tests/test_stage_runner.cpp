@@ -0,0 +1,138 @@
+#include <gtest/gtest.h>
+#include "stage_runner.h"
+#include <mutex>
+#include <stdexcept>
+
+using namespace PaddleOCR;
+
+namespace {
+
+struct Worker {
+    std::string name;
+};
+
+struct Item {
+    int id;
+    std::string trace; // Names of the workers that ran it
+};
+
+typedef StageRunner<Worker, Item> Runner;
+
+struct Finished {
+    std::mutex mutex;
+    std::vector<int> ids;
+    std::vector<std::string> traces, errors, finishers;
+
+    Runner::Finish finish() {
+        return [this](Worker &worker, Item &item, const std::string &error) {
+            std::lock_guard<std::mutex> lock(mutex);
+            ids.push_back(item.id);
+            traces.push_back(item.trace);
+            errors.push_back(error);
+            finishers.push_back(worker.name);
+        };
+    }
+};
+
+Runner::Stage stage(const char *name, Worker &worker) {
+    Runner::Stage s;
+    s.name = name;
+    s.workers.push_back(&worker);
+    s.work = [](Worker &w, Item &item) { item.trace += w.name; };
+    return s;
+}
+
+std::unique_ptr<Item> item(int id) {
+    return std::unique_ptr<Item>(new Item{id, ""});
+}
+
+} // namespace
+
+TEST(StageRunnerTest, PassesItemsThroughStagesInOrder) {
+    Worker a{"a"}, b{"b"}, c{"c"};
+    Finished finished;
+    {
+        Runner runner({stage("det", a), stage("cls", b), stage("rec", c)}, 2, finished.finish());
+        for (int i = 0; i < 50; i++)
+            runner.submit(item(i));
+    } // Destruction finishes the queued items
+    ASSERT_EQ(finished.ids.size(), 50u);
+    for (int i = 0; i < 50; i++) {
+        EXPECT_EQ(finished.ids[i], i); // One thread per stage keeps the order
+        EXPECT_EQ(finished.traces[i], "abc");
+        EXPECT_EQ(finished.errors[i], "");
+        EXPECT_EQ(finished.finishers[i], "c");
+    }
+}
+
+TEST(StageRunnerTest, FailedItemEndsWithError) {
+    Worker a{"a"}, b{"b"}, c{"c"};
+    Finished finished;
+    std::vector<Runner::Stage> stages = {stage("det", a), stage("cls", b), stage("rec", c)};
+    stages[1].work = [](Worker &w, Item &item) {
+        if (item.id % 3 == 1)
+            throw std::runtime_error("bad image");
+        if (item.id % 3 == 2)
+            throw 42; // Not an std::exception
+        item.trace += w.name;
+    };
+    {
+        Runner runner(std::move(stages), 1, finished.finish());
+        for (int i = 0; i < 9; i++)
+            runner.submit(item(i));
+        runner.stop();
+    }
+    ASSERT_EQ(finished.ids.size(), 9u); // Every item is finished exactly once
+    std::vector<int> seen(9, 0);
+    for (size_t k = 0; k < finished.ids.size(); k++) {
+        int id = finished.ids[k];
+        seen[id]++;
+        if (id % 3 == 0) {
+            EXPECT_EQ(finished.errors[k], "");
+            EXPECT_EQ(finished.traces[k], "abc");
+            EXPECT_EQ(finished.finishers[k], "c");
+        } else {
+            EXPECT_EQ(finished.errors[k], id % 3 == 1 ? "bad image" : "unknown error");
+            EXPECT_EQ(finished.traces[k], "a"); // Skips the stages after the failed one
+            EXPECT_EQ(finished.finishers[k], "b");
+        }
+    }
+    for (int n : seen)
+        EXPECT_EQ(n, 1);
+}
+
+TEST(StageRunnerTest, FinishThrowingKeepsTheStageRunning) {
+    Worker a{"a"}, b{"b"};
+    std::vector<int> ids;
+    {
+        Runner runner({stage("det", a), stage("rec", b)}, 1, [&ids](Worker &, Item &item, const std::string &) {
+            ids.push_back(item.id); // Only the rec thread finishes, no lock needed
+            if (item.id == 0)
+                throw std::runtime_error("write failed");
+        });
+        for (int i = 0; i < 3; i++)
+            runner.submit(item(i));
+    }
+    EXPECT_EQ(ids, (std::vector<int>{0, 1, 2}));
+}
+
+TEST(StageRunnerTest, SeveralThreadsPerStageFinishEveryItem) {
+    Worker a1{"a"}, a2{"a"}, b1{"b"}, b2{"b"};
+    Finished finished;
+    Runner::Stage det = stage("det", a1), rec = stage("rec", b1);
+    det.workers.push_back(&a2);
+    rec.workers.push_back(&b2);
+    {
+        Runner runner({det, rec}, 4, finished.finish());
+        for (int i = 0; i < 200; i++)
+            runner.submit(item(i));
+    }
+    ASSERT_EQ(finished.ids.size(), 200u);
+    std::vector<int> seen(200, 0);
+    for (size_t k = 0; k < finished.ids.size(); k++) {
+        seen[finished.ids[k]]++;
+        EXPECT_EQ(finished.traces[k], "ab");
+    }
+    for (int n : seen)
+        EXPECT_EQ(n, 1);
+}